@@ -0,0 +1,627 @@
+// Microbenchmarks for the catalog and archive kernels (nerdfonts_kernels.c).
+//
+// Output follows Google Benchmark's console format so numbers can be
+// compared run to run with the same tooling.  Every input is synthetic and
+// generated in memory: release JSON shaped like GitHub's releases API, zip
+// central directories and whole archives shaped like the Nerd Fonts ones,
+// and pairs of archive-sized buffers for the delta-update matcher.
+//
+//   make microbench
+//   make microbench BENCH_ARGS="--benchmark_filter=Zip --benchmark_min_time=2"
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+
+#include "nerdfonts_kernels.h"
+
+#define DEFAULT_MIN_TIME 0.5   // seconds per benchmark
+#define MAX_ITERATIONS   1000000000ULL
+#define EXTRACT_BYTES    (4UL << 20)   // uncompressed size of BM_ZipExtract*
+
+struct State {
+    long     arg;
+    void    *data;
+    size_t   data_len;
+    uint64_t bytes;   // processed per iteration, for bytes_per_second
+    uint64_t items;   // processed per iteration, for items_per_second
+};
+
+struct Benchmark {
+    const char *name;
+    long        args[5];   // 0-terminated
+    void      (*setup)(struct State *st);
+    void      (*run)(struct State *st, uint64_t iterations);
+    void      (*teardown)(struct State *st);
+};
+
+// Keeps results alive so the optimizer cannot drop the work.
+static volatile long sink;
+
+static double clock_seconds(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void *xmalloc(size_t size) {
+    void *p = malloc(size);
+    if (!p) {
+        fprintf(stderr, "microbench: out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+static void free_data(struct State *st) {
+    free(st->data);
+    st->data = NULL;
+}
+
+static void put_le16(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_le32(unsigned char *p, uint32_t v) {
+    put_le16(p, v);
+    put_le16(p + 2, v >> 16);
+}
+
+// ============================================================================
+// SYNTHETIC INPUTS
+// ============================================================================
+
+// A releases/latest body with n fonts.  Like the real API, every font ships
+// as .zip and .tar.xz, and FontPatcher.zip is mixed in.
+static char *make_release_json(long n, size_t *out_len) {
+    size_t cap = 4096 + (size_t)n * 2 * 640;
+    char *buf = xmalloc(cap);
+    size_t len = 0;
+
+    len += (size_t)snprintf(buf + len, cap - len,
+        "{\"tag_name\":\"v3.4.0\",\"name\":\"v3.4.0\",\"draft\":false,"
+        "\"prerelease\":false,\"published_at\":\"2025-04-24T21:03:36Z\","
+        "\"assets\":[");
+    for (long i = 0; i < n; i++) {
+        for (int ext = 0; ext < 2; ext++) {
+            char name[64];
+            if (i == n / 2 && ext == 0)
+                snprintf(name, sizeof(name), "FontPatcher");
+            else
+                snprintf(name, sizeof(name), "Family%ldNerd", i);
+            len += (size_t)snprintf(buf + len, cap - len,
+                "%s{\"url\":\"https://api.github.com/repos/ryanoasis/"
+                "nerd-fonts/releases/assets/%ld\",\"id\":%ld,"
+                "\"name\":\"%s.%s\",\"label\":\"\",\"content_type\":"
+                "\"application/%s\",\"state\":\"uploaded\",\"size\":%ld,"
+                "\"digest\":\"sha256:%064lx\",\"download_count\":%ld,"
+                "\"created_at\":\"2025-04-24T21:03:36Z\",\"updated_at\":"
+                "\"2025-04-24T21:03:37Z\",\"browser_download_url\":"
+                "\"https://github.com/ryanoasis/nerd-fonts/releases/download/"
+                "v3.4.0/%s.%s\"}",
+                i == 0 && ext == 0 ? "" : ",", 250000000L + i * 2 + ext,
+                250000000L + i * 2 + ext, name, ext ? "tar.xz" : "zip",
+                ext ? "x-xz" : "zip", 1000000L + i * 7919,
+                (unsigned long)i * 2654435761UL, 5000L + i,
+                name, ext ? "tar.xz" : "zip");
+        }
+    }
+    len += (size_t)snprintf(buf + len, cap - len, "]}");
+    *out_len = len;
+    return buf;
+}
+
+// Entry i's name, following the patched-font pattern.
+static int font_file_name(long i, char *out, size_t out_size) {
+    static const char *const styles[] = {
+        "Regular", "Bold", "Italic", "BoldItalic", "Light", "Medium"
+    };
+    return snprintf(out, out_size, "Family%ldNerdFont%s-%s.ttf", i / 18,
+                    i % 3 == 0 ? "" : i % 3 == 1 ? "Mono" : "Propo",
+                    styles[i % 6]);
+}
+
+// A zip holding only a central directory and end record, which is all
+// zip_for_each_entry reads.
+static unsigned char *make_zip_directory(long entries, size_t *out_len) {
+    size_t cap = (size_t)entries * (ZIP_CDIR_LEN + 64) + ZIP_EOCD_LEN;
+    unsigned char *buf = xmalloc(cap);
+    size_t pos = 0;
+
+    for (long i = 0; i < entries; i++) {
+        char name[64];
+        int name_len = font_file_name(i, name, sizeof(name));
+        unsigned char *c = buf + pos;
+        memset(c, 0, ZIP_CDIR_LEN);
+        put_le32(c, ZIP_CDIR_SIG);
+        put_le16(c + 10, 8);                         // deflate
+        put_le32(c + 16, (uint32_t)i * 2654435761U); // crc32
+        put_le32(c + 20, 400000U);
+        put_le32(c + 24, 1200000U);
+        put_le16(c + 28, (uint32_t)name_len);
+        put_le32(c + 42, (uint32_t)i * 400080U);
+        memcpy(c + ZIP_CDIR_LEN, name, (size_t)name_len); // flawfinder: ignore
+        pos += ZIP_CDIR_LEN + (size_t)name_len;
+    }
+
+    unsigned char *e = buf + pos;
+    memset(e, 0, ZIP_EOCD_LEN);
+    put_le32(e, ZIP_EOCD_SIG);
+    put_le16(e + 8, (uint32_t)entries);
+    put_le16(e + 10, (uint32_t)entries);
+    put_le32(e + 12, (uint32_t)pos);
+    put_le32(e + 16, 0);
+    *out_len = pos + ZIP_EOCD_LEN;
+    return buf;
+}
+
+// Pseudo-random bytes (xorshift32), standing in for compressed font data.
+static unsigned char *make_random_bytes(size_t len, uint32_t seed) {
+    unsigned char *buf = xmalloc(len);
+    uint32_t x = seed ? seed : 1;
+    for (size_t i = 0; i < len; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        buf[i] = (unsigned char)x;
+    }
+    return buf;
+}
+
+// Font-like data: random bytes with every other 64-byte run replaced by a
+// repeating table pattern, so deflate gets roughly the 2:1 of a real TTF.
+static unsigned char *make_font_bytes(size_t len, uint32_t seed) {
+    unsigned char *buf = make_random_bytes(len, seed);
+    for (size_t off = 64; off < len; off += 128) {
+        size_t run = len - off < 64 ? len - off : 64;
+        for (size_t i = 0; i < run; i++)
+            buf[off + i] = (unsigned char)(i & 0x0f);
+    }
+    return buf;
+}
+
+// A complete zip of `entries` font files sharing EXTRACT_BYTES between
+// them, stored or raw-deflated like the release archives.
+static unsigned char *make_zip_archive(long entries, int method,
+                                       size_t *out_len) {
+    size_t entry_len = EXTRACT_BYTES / (size_t)entries;
+    size_t cap = (size_t)entries * (ZIP_LOCAL_LEN + ZIP_CDIR_LEN + 128 +
+                                    compressBound((uLong)entry_len)) +
+                 ZIP_EOCD_LEN;
+    unsigned char *buf = xmalloc(cap);
+    uint32_t *crcs = xmalloc((size_t)entries * sizeof(*crcs));
+    uint32_t *comp = xmalloc((size_t)entries * sizeof(*comp));
+    uint32_t *offs = xmalloc((size_t)entries * sizeof(*offs));
+    size_t pos = 0;
+
+    for (long i = 0; i < entries; i++) {
+        char name[64];
+        int name_len = font_file_name(i, name, sizeof(name));
+        unsigned char *data = make_font_bytes(entry_len, (uint32_t)i + 3);
+        unsigned char *l = buf + pos;
+        unsigned char *out = l + ZIP_LOCAL_LEN + name_len;
+        size_t out_len_i = entry_len;
+
+        if (method == ZIP_DEFLATED) {
+            z_stream zs;
+            memset(&zs, 0, sizeof(zs));
+            if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                             -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                abort();
+            zs.next_in   = data;
+            zs.avail_in  = (uInt)entry_len;
+            zs.next_out  = out;
+            zs.avail_out = (uInt)(cap - (size_t)(out - buf));
+            if (deflate(&zs, Z_FINISH) != Z_STREAM_END)
+                abort();
+            out_len_i = zs.total_out;
+            deflateEnd(&zs);
+        } else {
+            memcpy(out, data, entry_len); // flawfinder: ignore
+        }
+
+        crcs[i] = (uint32_t)crc32(crc32(0L, Z_NULL, 0), data, (uInt)entry_len);
+        comp[i] = (uint32_t)out_len_i;
+        offs[i] = (uint32_t)pos;
+        free(data);
+
+        memset(l, 0, ZIP_LOCAL_LEN);
+        put_le32(l, ZIP_LOCAL_SIG);
+        put_le16(l + 4, 20);
+        put_le16(l + 8, (uint32_t)method);
+        put_le32(l + 14, crcs[i]);
+        put_le32(l + 18, comp[i]);
+        put_le32(l + 22, (uint32_t)entry_len);
+        put_le16(l + 26, (uint32_t)name_len);
+        memcpy(l + ZIP_LOCAL_LEN, name, (size_t)name_len); // flawfinder: ignore
+        pos += ZIP_LOCAL_LEN + (size_t)name_len + out_len_i;
+    }
+
+    size_t cdir = pos;
+    for (long i = 0; i < entries; i++) {
+        char name[64];
+        int name_len = font_file_name(i, name, sizeof(name));
+        unsigned char *c = buf + pos;
+        memset(c, 0, ZIP_CDIR_LEN);
+        put_le32(c, ZIP_CDIR_SIG);
+        put_le16(c + 10, (uint32_t)method);
+        put_le32(c + 16, crcs[i]);
+        put_le32(c + 20, comp[i]);
+        put_le32(c + 24, (uint32_t)entry_len);
+        put_le16(c + 28, (uint32_t)name_len);
+        put_le32(c + 42, offs[i]);
+        memcpy(c + ZIP_CDIR_LEN, name, (size_t)name_len); // flawfinder: ignore
+        pos += ZIP_CDIR_LEN + (size_t)name_len;
+    }
+    free(crcs);
+    free(comp);
+    free(offs);
+
+    unsigned char *e = buf + pos;
+    memset(e, 0, ZIP_EOCD_LEN);
+    put_le32(e, ZIP_EOCD_SIG);
+    put_le16(e + 8, (uint32_t)entries);
+    put_le16(e + 10, (uint32_t)entries);
+    put_le32(e + 12, (uint32_t)(pos - cdir));
+    put_le32(e + 16, (uint32_t)cdir);
+    *out_len = pos + ZIP_EOCD_LEN;
+    return buf;
+}
+
+// ============================================================================
+// BENCHMARKS
+// ============================================================================
+
+static void setup_font_name(struct State *st) {
+    st->data = xmalloc((size_t)st->arg + 1);
+    for (long i = 0; i < st->arg; i++)
+        ((char *)st->data)[i] = "FiraCodeNerdFontMono-Regular_"[i % 29];
+    ((char *)st->data)[st->arg] = '\0';
+    st->bytes = (uint64_t)st->arg;
+}
+
+static void run_sanitize(struct State *st, uint64_t iterations) {
+    char out[MAX_FONT_NAME_LEN];
+    for (uint64_t i = 0; i < iterations; i++)
+        sink += sanitize_font_name(st->data, out, sizeof(out));
+}
+
+// Feed arg KiB through write_callback in libcurl-sized (16 KiB) chunks.
+static void setup_response(struct State *st) {
+    st->data = xmalloc(16384);
+    memset(st->data, 'x', 16384);
+    st->bytes = (uint64_t)st->arg * 1024;
+}
+
+static void run_write_callback(struct State *st, uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        struct HTTPResponse response = {0};
+        for (uint64_t done = 0; done < st->bytes; done += 16384) {
+            size_t chunk = st->bytes - done < 16384
+                         ? (size_t)(st->bytes - done) : 16384;
+            write_callback(st->data, 1, chunk, &response);
+        }
+        sink += (long)response.size;
+        free(response.memory);
+    }
+}
+
+static void setup_release_json(struct State *st) {
+    st->data = make_release_json(st->arg, &st->data_len);
+    st->bytes = st->data_len;
+    st->items = (uint64_t)st->arg * 2;
+}
+
+// Parse and filter: the whole catalog path after the HTTP body arrives.
+static void run_parse_release(struct State *st, uint64_t iterations) {
+    static struct FontList list;
+    for (uint64_t i = 0; i < iterations; i++) {
+        json_error_t error;
+        json_t *root = json_loadb(st->data, st->data_len, 0, &error);
+        if (!root)
+            abort();
+        sink += filter_font_assets(json_object_get(root, "assets"), &list);
+        sink += list.count;
+        json_decref(root);
+    }
+}
+
+static void setup_parsed_release(struct State *st) {
+    size_t len;
+    char *body = make_release_json(st->arg, &len);
+    json_error_t error;
+    st->data = json_loadb(body, len, 0, &error);
+    free(body);
+    if (!st->data)
+        abort();
+    st->items = (uint64_t)st->arg * 2;
+}
+
+static void run_filter_assets(struct State *st, uint64_t iterations) {
+    static struct FontList list;
+    const json_t *assets = json_object_get(st->data, "assets");
+    for (uint64_t i = 0; i < iterations; i++) {
+        sink += filter_font_assets(assets, &list);
+        sink += list.count;
+    }
+}
+
+static void teardown_parsed_release(struct State *st) {
+    json_decref(st->data);
+    st->data = NULL;
+}
+
+static void setup_font_list(struct State *st) {
+    struct FontList *list = xmalloc(sizeof(*list));
+    list->count = (int)st->arg;
+    for (int i = 0; i < list->count; i++)
+        snprintf(list->names[i], MAX_FONT_NAME_LEN, "%s%d",
+                 i % 2 ? "IosevkaTermSlab" : "Hack", i);
+    st->data = list;
+    st->items = (uint64_t)st->arg;
+}
+
+static void run_print_columns(struct State *st, uint64_t iterations) {
+    FILE *out = fopen("/dev/null", "w");
+    if (!out)
+        abort();
+    for (uint64_t i = 0; i < iterations; i++)
+        print_fonts_in_columns(out, st->data, 120);
+    sink += ftell(out);
+    fclose(out);
+}
+
+static void setup_zip(struct State *st) {
+    st->data = make_zip_directory(st->arg, &st->data_len);
+    st->bytes = st->data_len;
+    st->items = (uint64_t)st->arg;
+}
+
+static int visit_entry(const struct ZipEntry *entry, void *ctx) {
+    char name[256];
+    *(long *)ctx += zip_entry_safe_name(entry, name, sizeof(name));
+    return 0;
+}
+
+static void run_zip_entries(struct State *st, uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        long safe = 0;
+        sink += zip_for_each_entry(st->data, st->data_len, visit_entry, &safe);
+        sink += safe;
+    }
+}
+
+// Extract every entry of an EXTRACT_BYTES archive split into arg files:
+// local header checks, inflate (or copy), CRC-32 and the size guard.
+static int count_output(const unsigned char *buf, size_t len, void *ctx) {
+    *(long *)ctx += (long)len + buf[len - 1];
+    return 0;
+}
+
+static int extract_entry(const struct ZipEntry *entry, void *ctx) {
+    return zip_extract_entry(entry, count_output, ctx);
+}
+
+static void run_zip_extract(struct State *st, uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        long out = 0;
+        if (zip_for_each_entry(st->data, st->data_len, extract_entry,
+                               &out) != st->arg)
+            abort();
+        sink += out;
+    }
+}
+
+static void setup_zip_stored(struct State *st) {
+    st->data = make_zip_archive(st->arg, ZIP_STORED, &st->data_len);
+    st->bytes = EXTRACT_BYTES;
+    st->items = (uint64_t)st->arg;
+}
+
+static void setup_zip_deflated(struct State *st) {
+    st->data = make_zip_archive(st->arg, ZIP_DEFLATED, &st->data_len);
+    st->bytes = EXTRACT_BYTES;
+    st->items = (uint64_t)st->arg;
+}
+
+static void setup_sha256(struct State *st) {
+    st->data_len = (size_t)st->arg * 1024;
+    st->data = make_random_bytes(st->data_len, 7);
+    st->bytes = st->data_len;
+}
+
+static void run_sha256(struct State *st, uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        struct Sha256 ctx;
+        unsigned char digest[SHA256_LEN];
+        sha256_init(&ctx);
+        sha256_update(&ctx, st->data, st->data_len);
+        sha256_final(&ctx, digest);
+        sink += digest[0];
+    }
+}
+
+// An arg KiB "new release" archive and the old one it is matched against:
+// the same bytes with one font in ten rewritten and 100 bytes inserted near
+// the start, so most blocks are found at shifted offsets.
+struct DeltaInput {
+    unsigned char    *old;
+    size_t            old_len;
+    unsigned char    *index_buf;
+    struct BlockIndex index;
+    uint64_t         *matches;
+};
+
+static void setup_delta(struct State *st) {
+    struct DeltaInput *in = xmalloc(sizeof(*in));
+    size_t len = (size_t)st->arg * 1024;
+    if (len < 8192 || len > ((size_t)1 << 32))
+        abort();
+    unsigned char *fresh = make_random_bytes(len, 11);
+
+    in->old_len = len + 100;
+    in->old = xmalloc(in->old_len);
+    memcpy(in->old, fresh, 4096);                       // flawfinder: ignore
+    memset(in->old + 4096, 0x5a, 100);
+    memcpy(in->old + 4196, fresh + 4096, len - 4096);   // flawfinder: ignore
+    for (size_t off = 4196; off + 40960 <= in->old_len; off += 409600)
+        memset(in->old + off, 0xa5, 40960);
+
+    size_t index_len = delta_index_len(len, DELTA_BLOCK_SIZE);
+    in->index_buf = xmalloc(index_len);
+    delta_build_index(fresh, len, DELTA_BLOCK_SIZE, in->index_buf);
+    free(fresh);
+    if (!delta_parse_index(in->index_buf, index_len, &in->index))
+        abort();
+    in->matches = xmalloc(in->index.count * sizeof(*in->matches));
+
+    st->data  = in;
+    st->bytes = in->old_len;
+    st->items = in->index.count;
+}
+
+static void run_delta_match(struct State *st, uint64_t iterations) {
+    struct DeltaInput *in = st->data;
+    for (uint64_t i = 0; i < iterations; i++)
+        sink += delta_match_blocks(&in->index, in->old, in->old_len,
+                                   in->matches);
+}
+
+static void teardown_delta(struct State *st) {
+    struct DeltaInput *in = st->data;
+    free(in->old);
+    free(in->index_buf);
+    free(in->matches);
+    free(in);
+    st->data = NULL;
+}
+
+static const struct Benchmark benchmarks[] = {
+    { "BM_SanitizeFontName", { 8, 24, 48, 0 },
+      setup_font_name, run_sanitize, free_data },
+    { "BM_WriteCallback", { 64, 1024, 16384, 0 },
+      setup_response, run_write_callback, free_data },
+    { "BM_ParseReleaseJson", { 10, 100, 1000, 0 },
+      setup_release_json, run_parse_release, free_data },
+    { "BM_FilterFontAssets", { 10, 100, 1000, 0 },
+      setup_parsed_release, run_filter_assets, teardown_parsed_release },
+    { "BM_PrintFontsInColumns", { 10, 50, 100, 0 },
+      setup_font_list, run_print_columns, free_data },
+    { "BM_ZipForEachEntry", { 10, 100, 1000, 10000, 0 },
+      setup_zip, run_zip_entries, free_data },
+    { "BM_ZipExtractStored", { 1, 16, 256, 0 },
+      setup_zip_stored, run_zip_extract, free_data },
+    { "BM_ZipExtractDeflated", { 1, 16, 256, 0 },
+      setup_zip_deflated, run_zip_extract, free_data },
+    { "BM_Sha256", { 4, 64, 1024, 0 },
+      setup_sha256, run_sha256, free_data },
+    { "BM_DeltaMatchBlocks", { 256, 4096, 65536, 0 },
+      setup_delta, run_delta_match, teardown_delta },
+};
+
+// ============================================================================
+// RUNNER
+// ============================================================================
+
+// Append a Google Benchmark style counter ("bytes_per_second=1.5Gi/s").
+static void append_rate(char *out, size_t out_size, const char *label,
+                        double rate, int binary) {
+    static const char prefixes[] = " kMGT";
+    double base = binary ? 1024.0 : 1000.0;
+    int p = 0;
+    while (rate >= base && p < 4) {
+        rate /= base;
+        p++;
+    }
+    size_t used = strlen(out); // flawfinder: ignore
+    snprintf(out + used, out_size - used, "%s%s=%.4g%.*s%s/s",
+             used ? " " : "", label, rate, p > 0, &prefixes[p],
+             p > 0 && binary ? "i" : "");
+}
+
+// Run one benchmark, growing the iteration count until a batch takes at
+// least min_time, the way Google Benchmark settles on its iterations.
+static void run_benchmark(const struct Benchmark *b, long arg,
+                          double min_time) {
+    struct State st = { .arg = arg };
+    b->setup(&st);
+
+    uint64_t iterations = 1;
+    double wall = 0.0, cpu = 0.0;
+    for (;;) {
+        double w0 = clock_seconds(CLOCK_MONOTONIC);
+        double c0 = clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+        b->run(&st, iterations);
+        wall = clock_seconds(CLOCK_MONOTONIC) - w0;
+        cpu  = clock_seconds(CLOCK_PROCESS_CPUTIME_ID) - c0;
+        if (wall >= min_time || iterations >= MAX_ITERATIONS)
+            break;
+
+        // Aim 40% past min_time, growing at most 10x per round.
+        double scale = wall > 0.0 ? min_time * 1.4 / wall : 10.0;
+        if (scale > 10.0)
+            scale = 10.0;
+        uint64_t next = (uint64_t)((double)iterations * scale);
+        iterations = next > iterations ? next : iterations + 1;
+    }
+
+    char name[64], counters[96] = "";
+    snprintf(name, sizeof(name), "%s/%ld", b->name, arg);
+    if (st.bytes > 0)
+        append_rate(counters, sizeof(counters), "bytes_per_second",
+                    (double)st.bytes * (double)iterations / wall, 1);
+    if (st.items > 0)
+        append_rate(counters, sizeof(counters), "items_per_second",
+                    (double)st.items * (double)iterations / wall, 0);
+
+    printf("%-34s %10.0f ns %10.0f ns %12llu %s\n", name,
+           wall * 1e9 / (double)iterations, cpu * 1e9 / (double)iterations,
+           (unsigned long long)iterations, counters);
+    fflush(stdout);
+
+    b->teardown(&st);
+}
+
+int main(int argc, char *argv[]) {
+    const char *filter = NULL;
+    double min_time = DEFAULT_MIN_TIME;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--benchmark_filter=", 19) == 0) {
+            filter = argv[i] + 19;
+        } else if (strncmp(argv[i], "--benchmark_min_time=", 21) == 0) {
+            char *end;
+            min_time = strtod(argv[i] + 21, &end);
+            if ((*end != '\0' && strcmp(end, "s") != 0) || min_time <= 0.0 ||
+                min_time > 60.0) {
+                fprintf(stderr, "--benchmark_min_time expects seconds in "
+                        "(0, 60]\n");
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Usage: %s [--benchmark_filter=SUBSTRING] "
+                    "[--benchmark_min_time=S]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("%-34s %13s %13s %12s %s\n", "Benchmark", "Time", "CPU",
+           "Iterations", "UserCounters...");
+    for (int i = 0; i < 100; i++)
+        putchar('-');
+    putchar('\n');
+
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        const struct Benchmark *b = &benchmarks[i];
+        for (const long *arg = b->args; *arg != 0; arg++) {
+            char name[64];
+            snprintf(name, sizeof(name), "%s/%ld", b->name, *arg);
+            if (!filter || strstr(name, filter))
+                run_benchmark(b, *arg, min_time);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+// libFuzzer harness for the delta-update block index.  The input is parsed
+// as an index from a mirror, and if that works, matched against itself as
+// the old archive; every match must lie inside it.  The input is also
+// indexed with delta_build_index, which must parse back, and matched
+// against that index the same way.
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+
+#include "nerdfonts_kernels.h"
+#include "fuzz_throughput.h"
+
+#define FUZZ_BLOCK_SIZE DELTA_MIN_BLOCK
+
+static void check_matches(const struct BlockIndex *index, const uint8_t *old,
+                          size_t old_len) {
+    uint64_t *matches = calloc(index->count ? index->count : 1,
+                               sizeof(*matches));
+    if (!matches)
+        return;
+    long matched = delta_match_blocks(index, old, old_len, matches);
+    long seen = 0;
+    for (size_t i = 0; i < index->count; i++) {
+        if (matches[i] == DELTA_NO_MATCH)
+            continue;
+        uint64_t len = i + 1 < index->count
+                     ? index->block_size
+                     : index->file_size - i * (uint64_t)index->block_size;
+        FUZZ_CHECK(matches[i] <= old_len && len <= old_len - matches[i]);
+        seen++;
+    }
+    FUZZ_CHECK(matched < 0 || matched == seen);
+    free(matches);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    struct BlockIndex index;
+
+    double started = fuzz_begin("delta_block_index");
+    if (delta_parse_index(data, size, &index))
+        check_matches(&index, data, size);
+
+    size_t len = delta_index_len(size, FUZZ_BLOCK_SIZE);
+    unsigned char *built = len ? malloc(len) : NULL;
+    if (built) {
+        delta_build_index(data, size, FUZZ_BLOCK_SIZE, built);
+        FUZZ_CHECK(delta_parse_index(built, len, &index));
+        FUZZ_CHECK(index.file_size == size);
+        check_matches(&index, data, size);
+        free(built);
+    }
+    fuzz_end(started, size);
+    return 0;
+}
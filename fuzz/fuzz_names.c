@@ -0,0 +1,52 @@
+// libFuzzer harness for sanitize_font_name() and write_callback().  The
+// first byte picks the chunk size write_callback is fed; the rest is the
+// payload, which must come back byte for byte and NUL-terminated.
+#define _POSIX_C_SOURCE 200809L
+#include <ctype.h>
+#include <string.h>
+
+#include "nerdfonts_kernels.h"
+#include "fuzz_throughput.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size == 0)
+        return 0;
+
+    size_t chunk = (size_t)data[0] + 1;
+    const char *payload = (const char *)data + 1;
+    size_t len = size - 1;
+
+    char *input = malloc(len + 1);
+    if (!input)
+        return 0;
+    memcpy(input, payload, len); // flawfinder: ignore
+    input[len] = '\0';
+
+    double started = fuzz_begin("names_and_responses");
+    char name[MAX_FONT_NAME_LEN];
+    int ok = sanitize_font_name(input, name, sizeof(name));
+
+    struct HTTPResponse response = {0};
+    for (size_t done = 0; done < len; done += chunk) {
+        size_t n = len - done < chunk ? len - done : chunk;
+        FUZZ_CHECK(write_callback(payload + done, 1, n, &response) == n);
+    }
+    fuzz_end(started, size);
+
+    if (ok) {
+        FUZZ_CHECK(strcmp(name, input) == 0 && name[0] != '.' &&
+                   strstr(name, "..") == NULL);
+        for (const char *c = name; *c; c++)
+            FUZZ_CHECK(isalnum((unsigned char)*c) || *c == '-' ||
+                       *c == '_' || *c == '.');
+    }
+    FUZZ_CHECK(response.size == len);
+    FUZZ_CHECK(len == 0 || (memcmp(response.memory, payload, len) == 0 &&
+                            response.memory[len] == '\0'));
+
+    free(response.memory);
+    free(input);
+    return 0;
+}
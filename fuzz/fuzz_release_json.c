@@ -0,0 +1,39 @@
+// libFuzzer harness for the catalog path: parse a release body, filter its
+// assets into a FontList and lay the list out in columns.
+#define _POSIX_C_SOURCE 200809L
+#include <string.h>
+
+#include "nerdfonts_kernels.h"
+#include "fuzz_throughput.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static struct FontList list;
+    static FILE *devnull;
+    if (!devnull && !(devnull = fopen("/dev/null", "w")))
+        abort();
+
+    double started = fuzz_begin("release_json");
+    json_error_t error;
+    json_t *root = json_loadb((const char *)data, size, 0, &error);
+    if (!root) {
+        fuzz_end(started, size);
+        return 0;
+    }
+
+    json_t *assets = json_is_array(root) ? root
+                                         : json_object_get(root, "assets");
+    int omitted = filter_font_assets(assets, &list);
+    print_fonts_in_columns(devnull, &list, (int)(size % 300));
+    fuzz_end(started, size);
+
+    FUZZ_CHECK(omitted >= 0);
+    FUZZ_CHECK(list.count >= 0 && list.count <= MAX_FONTS);
+    for (int i = 0; i < list.count; i++) {
+        FUZZ_CHECK(memchr(list.names[i], '\0', MAX_FONT_NAME_LEN) != NULL);
+        FUZZ_CHECK(strcmp(list.names[i], "FontPatcher") != 0);
+    }
+    json_decref(root);
+    return 0;
+}
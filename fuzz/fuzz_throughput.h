@@ -0,0 +1,53 @@
+// Throughput accounting shared by the fuzz harnesses.  libFuzzer reports
+// exec/s including its own mutation and coverage overhead; this measures
+// just the time spent in the kernel under test and prints MiB/s at exit,
+// so a fixed-length fuzz run doubles as a coarse regression benchmark.
+#ifndef FUZZ_THROUGHPUT_H
+#define FUZZ_THROUGHPUT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Abort (and so report a crash) when a harness invariant does not hold.
+#define FUZZ_CHECK(cond) \
+    do { if (!(cond)) { fprintf(stderr, "check failed: %s\n", #cond); \
+                        abort(); } } while (0)
+
+static const char *fuzz_name;
+static uint64_t    fuzz_execs;
+static uint64_t    fuzz_bytes;
+static double      fuzz_seconds;
+
+static double fuzz_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void fuzz_report(void) {
+    if (fuzz_execs == 0 || fuzz_seconds <= 0.0)
+        return;
+    double mib = (double)fuzz_bytes / (1024.0 * 1024.0);
+    fprintf(stderr, "#throughput %s: %llu execs, %.2f MiB in %.3fs of kernel "
+            "time: %.1f MiB/s, %.0f execs/s\n", fuzz_name,
+            (unsigned long long)fuzz_execs, mib, fuzz_seconds,
+            mib / fuzz_seconds, (double)fuzz_execs / fuzz_seconds);
+}
+
+static double fuzz_begin(const char *name) {
+    if (!fuzz_name) {
+        fuzz_name = name;
+        atexit(fuzz_report);
+    }
+    return fuzz_clock();
+}
+
+static void fuzz_end(double started, size_t len) {
+    fuzz_seconds += fuzz_clock() - started;
+    fuzz_bytes   += len;
+    fuzz_execs++;
+}
+
+#endif
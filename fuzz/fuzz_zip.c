@@ -0,0 +1,61 @@
+// libFuzzer harness for the zip central directory walker and extractor.
+// Whatever the input, zip_for_each_entry must stay inside the buffer, every
+// name zip_entry_safe_name accepts must be a relative path without "..",
+// and zip_extract_entry must never produce more than the declared size.
+#define _POSIX_C_SOURCE 200809L
+#include <string.h>
+
+#include "nerdfonts_kernels.h"
+#include "fuzz_throughput.h"
+
+struct Walk {
+    const uint8_t *data;
+    size_t         size;
+    long           visited;
+};
+
+struct Sink {
+    uint64_t declared;
+    uint64_t written;
+};
+
+static int count_output(const unsigned char *buf, size_t len, void *ctx) {
+    struct Sink *sink = ctx;
+    (void)buf;
+    sink->written += len;
+    FUZZ_CHECK(sink->written <= sink->declared);
+    return 0;
+}
+
+static int check_entry(const struct ZipEntry *entry, void *ctx) {
+    struct Walk *walk = ctx;
+    const char *begin = (const char *)walk->data;
+    FUZZ_CHECK(entry->name >= begin &&
+               entry->name_len <= walk->size &&
+               (size_t)(entry->name - begin) <= walk->size - entry->name_len);
+
+    char name[256];
+    if (zip_entry_safe_name(entry, name, sizeof(name))) {
+        FUZZ_CHECK(strlen(name) == entry->name_len); // flawfinder: ignore
+        FUZZ_CHECK(name[0] != '/' && strstr(name, "..") == NULL);
+    }
+
+    struct Sink sink = { entry->size, 0 };
+    if (zip_extract_entry(entry, count_output, &sink) == 0)
+        FUZZ_CHECK(sink.written == entry->size);
+
+    walk->visited++;
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    struct Walk walk = { data, size, 0 };
+    double started = fuzz_begin("zip_for_each_entry");
+    long count = zip_for_each_entry(data, size, check_entry, &walk);
+    fuzz_end(started, size);
+
+    FUZZ_CHECK(count < 0 || count == walk.visited);
+    return 0;
+}
@@ -0,0 +1,66 @@
+// Standalone driver for the fuzz harnesses, for toolchains without
+// libFuzzer: runs LLVMFuzzerTestOneInput once per file named on the command
+// line (directories are walked one level deep), e.g. to replay a corpus or
+// a crash reproducer under gcc and the sanitizers.
+#define _POSIX_C_SOURCE 200809L
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static int replay_file(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+
+    uint8_t *data = NULL;
+    size_t size = 0, cap = 0, n;
+    do {
+        if (size == cap) {
+            cap = cap ? cap * 2 : 65536;
+            uint8_t *grown = realloc(data, cap);
+            if (!grown) {
+                free(data);
+                fclose(fp);
+                return -1;
+            }
+            data = grown;
+        }
+        n = fread(data + size, 1, cap - size, fp); // flawfinder: ignore
+        size += n;
+    } while (n > 0);
+    fclose(fp);
+
+    LLVMFuzzerTestOneInput(data, size);
+    free(data);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int failures = 0;
+
+    for (int i = 1; i < argc; i++) {
+        struct stat st;
+        if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+            DIR *dir = opendir(argv[i]);
+            struct dirent *ent;
+            while (dir && (ent = readdir(dir)) != NULL) {
+                char path[4096];
+                if (ent->d_name[0] == '.')
+                    continue;
+                snprintf(path, sizeof(path), "%s/%s", argv[i], ent->d_name);
+                failures += replay_file(path) != 0;
+            }
+            if (dir)
+                closedir(dir);
+        } else {
+            failures += replay_file(argv[i]) != 0;
+        }
+    }
+    return failures > 0;
+}
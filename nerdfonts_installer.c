@@ -1,15 +1,26 @@
 #define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE   // syscall()
 #include <curl/curl.h>
+#include <dirent.h>
 #include <fcntl.h>
 #include <jansson.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <netdb.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <sys/vfs.h>
 #include <sys/wait.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
 #include <ctype.h>
 #include <errno.h>
@@ -18,6 +29,8 @@
 // cppcheck-suppress missingIncludeSystem
 #include <stdint.h>
 
+#include "nerdfonts_kernels.h"
+
 // ANSI Color codes
 #define COLOR_RED    "\033[0;31m"
 #define COLOR_GREEN  "\033[0;32m"
@@ -27,61 +40,237 @@
 #define COLOR_RESET  "\033[0m"
 
 // Constants
-#define MAX_FONTS        100
-#define MAX_FONT_NAME_LEN 50
 #define MAX_PATH_LEN     1024
 #define MAX_COMMAND_LEN  2048
+#define MAX_TAG_LEN      64
 #define MKDTEMP_SUFFIX   "/nerdfonts.XXXXXX"
 
-#define API_URL \
-    "https://api.github.com/repos/ryanoasis/nerd-fonts/releases/latest"
+#define MANIFEST_NAME    ".nerdfonts-manifest"
+
+// Disk space preflight
+#define EXTRACT_RATIO    2               // deflate roughly halves TTF/OTF
+#define DISK_HEADROOM    (32ULL << 20)   // never plan to fill a disk to 0
+#ifndef TMPFS_MAGIC
+#define TMPFS_MAGIC      0x01021994
+#endif
+
+// Package lists younger than this are not refreshed before installing.
+#define PKG_LISTS_MAX_AGE (24 * 60 * 60)
+
+// prune keeps these variants unless told otherwise.
+#define PRUNE_DEFAULT_SPACING "mono"
+#define PRUNE_DEFAULT_FORMATS "ttf"
+#define PRUNE_DEFAULT_STYLES  "Regular,Bold,Italic,BoldItalic"
+
+// Download resilience defaults (see --retries, --stall-timeout, --hedge-after)
+#define DEFAULT_RETRIES       3
+#define DEFAULT_STALL_TIMEOUT 30L     // seconds below STALL_MIN_SPEED
+#define STALL_MIN_SPEED       1024L   // bytes/s
+#define BACKOFF_BASE_MS       500L
+#define BACKOFF_MAX_MS        30000L
+#define RETRY_AFTER_MAX       300L    // longest Retry-After we will wait out
+
+// Delta updates
+#define DELTA_MERGE_GAP  4   // matched blocks re-fetched to save a request
+
+// Sharing a link or a host (see --max-rate, --idle).  RATE_MIN keeps every
+// concurrent transfer well above STALL_MIN_SPEED.
+#define RATE_MIN         (16ULL << 10)   // bytes/s
+#define IDLE_NICE        19
+
+// From linux/ioprio.h; glibc has no ioprio_set() wrapper.
+#ifndef IOPRIO_CLASS_IDLE
+#define IOPRIO_CLASS_IDLE  3
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_WHO_PROCESS 1
+#endif
+
+// Speculative prefetch while the font prompt is up
+#define PREFETCH_MAX      8   // archives fetched at once
+#define PREFETCH_AUTO     3   // families taken from the install history
+#define PREFETCH_PAGER_POLL_MS 100
+#define HISTORY_FILE_NAME "history"
+
+// --trace lanes (Chrome trace "tid"s): hedged requests and prompt-time
+// prefetches overlap other transfers, so they get tracks of their own.
+#define TRACE_LANE_MAIN     1
+#define TRACE_LANE_HEDGE    2
+#define TRACE_LANE_PREFETCH 3
+
+// serve: a plain-HTTP LAN mirror of the archive cache and catalog.
+#define SERVE_DEFAULT_BIND "0.0.0.0"
+#define SERVE_DEFAULT_PORT "8470"
+#define SERVE_MAX_REQUEST  8192
+#define SERVE_IO_TIMEOUT   30   // seconds per socket read/write
+#define CATALOG_TTL        600  // seconds before serve re-asks GitHub
+#define LATEST_STAMP       "latest"
+
+#define API_BASE_URL \
+    "https://api.github.com/repos/ryanoasis/nerd-fonts/releases"
+#define DOWNLOAD_BASE_URL \
+    "https://github.com/ryanoasis/nerd-fonts/releases/download"
+
+// Release index: a compact binary catalog of every release we have seen,
+// stored under the user cache dir and mmap'd at startup.  Layout:
+//   IndexHeader | IndexRelease[release_count] | IndexAsset[asset_count] |
+//   string table (NUL-terminated tags and bare asset names)
+// All integers are host-endian; the magic doubles as an endianness check.
+#define INDEX_FILE_NAME  "releases.idx"
+#define INDEX_MAGIC      0x5844494eU // "NIDX" on little-endian hosts
+#define INDEX_VERSION    2U
+#define INDEX_MAX_BYTES  (64UL * 1024UL * 1024UL)
+#define ASSET_HAS_DIGEST 0x1U
+// GitHub publishes a release before all of its assets are attached, so an
+// indexed release younger than this is re-checked against the API.
+#define RELEASE_SETTLE_SECS (24L * 60L * 60L)
 
 // Global state
-static char fonts[MAX_FONTS][MAX_FONT_NAME_LEN];
-static int  font_count = 0;
+static struct FontList catalog;
 static char tmp_path[MAX_PATH_LEN];
 static char fonts_path[MAX_PATH_LEN];
 static char current_zip_path[MAX_PATH_LEN] = {0};
+static char current_hedge_path[MAX_PATH_LEN] = {0};
 static char unique_tmp_dir[MAX_PATH_LEN]   = {0};
+static char cache_path[MAX_PATH_LEN];
+
+// Release selection: release_tag is the --release pin, or the tag resolved
+// from releases/latest once the catalog has been fetched.
+static char release_tag[MAX_TAG_LEN] = {0};
+static int  release_pinned = 0;
+
+// Optional LAN mirror (another host running `serve`) tried before GitHub,
+// and whether downloaded archives are kept in the cache for it to share.
+static char mirror_url[MAX_PATH_LEN] = {0};
+static int  keep_archives = 0;
+static int  delta_updates = 0;
+
+// Retry policy for catalog and archive transfers.  hedge_after == 0
+// disables hedged requests.
+static int  max_retries   = DEFAULT_RETRIES;
+static long stall_timeout = DEFAULT_STALL_TIMEOUT;
+static long hedge_after   = 0;
+
+// --max-rate: the combined download cap in bytes/s (0 = unlimited).
+static uint64_t max_rate      = 0;
+static int      idle_priority = 0;
+
+// --trace output (NULL when tracing is off).  Timestamps are relative to
+// trace_epoch, in microseconds.
+static FILE  *trace_fp = NULL;
+static double trace_epoch = 0.0;
+static int    trace_events = 0;
+
+// Read-only mapping of the release index (NULL when absent or invalid).
+static unsigned char *index_map = NULL;
+static size_t         index_map_len = 0;
+
+struct IndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t release_count;
+    uint32_t asset_count;
+    uint32_t strings_size;
+    uint32_t reserved;
+};
 
-// HTTP response buffer
-struct HTTPResponse {
-    char  *memory;
-    size_t size;
+struct IndexRelease {
+    uint32_t tag_off;
+    uint32_t first_asset;
+    uint32_t asset_count;
+    uint32_t published;   // seconds since the epoch (0 if unknown)
 };
 
-// ============================================================================
-// SECURITY HELPERS
-// ============================================================================
+struct IndexAsset {
+    uint32_t      name_off;
+    uint32_t      flags;
+    uint64_t      size;
+    unsigned char sha256[SHA256_LEN];
+};
 
-// Whitelist-based font name sanitizer.
-// Copies only [a-zA-Z0-9._-] into output; rejects anything else.
-// Satisfies CodeQL taint tracking by producing a clean copy.
-static int sanitize_font_name(const char *input, char *output, size_t max_len) {
-    if (!input || !output || max_len == 0)
-        return 0;
+// Phase timings (microseconds, as libcurl reports them) at the last
+// redirect response of a traced transfer.
+struct TraceHops {
+    CURL      *curl;
+    curl_off_t dns, connect, tls, pre, ttfb;
+};
 
-    size_t in_len = strlen(input); // flawfinder: ignore
-    if (in_len == 0 || in_len >= max_len)
-        return 0;
+// One transfer of a (possibly hedged) download attempt.
+struct Transfer {
+    CURL *curl;
+    FILE  *fp;
+    char   path[MAX_PATH_LEN];
+    double started;
+    struct TraceHops hops;
+};
 
-    // Reject leading dot or any path traversal
-    if (input[0] == '.' || strstr(input, "..") != NULL)
-        return 0;
+// An archive fetched into the cache while the user is still choosing.
+enum { PREFETCH_RUNNING, PREFETCH_DONE, PREFETCH_FAILED };
 
-    size_t out_idx = 0;
-    for (size_t i = 0; input[i] != '\0'; i++) {
-        if (out_idx >= max_len - 1)
-            break;
-        char c = input[i];
-        if (isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.')
-            output[out_idx++] = c;
-        else
-            return 0; // strict rejection
-    }
-    output[out_idx] = '\0';
-    return 1;
-}
+struct Prefetch {
+    int             font_idx;
+    int             state;
+    struct Transfer t;   // writes to <cached>.part
+    char            cached[MAX_PATH_LEN];
+};
+
+// Connections, DNS and TLS sessions shared by every transfer, so the ones
+// warmed up during the prompt are reused by the downloads after it.
+static CURLSH *curl_share = NULL;
+
+// Prompt-time transfers (see PREFETCH).  prefetch_list is the --prefetch
+// argument; prefetch_parts mirrors the in-flight .part files for the
+// signal handler.
+static CURLM          *prefetch_multi = NULL;
+static struct Transfer warmup;
+static const char     *prefetch_list = NULL;
+static struct Prefetch prefetches[PREFETCH_MAX];
+static int             prefetch_count = 0;
+static char            prefetch_parts[PREFETCH_MAX][MAX_PATH_LEN];
+
+// How to install packages in a single privileged transaction.  Packages
+// are appended to the command; install_stale also refreshes the package
+// lists and is used unless the newest file in lists_dir ending in
+// lists_suffix is younger than PKG_LISTS_MAX_AGE.
+struct PackageManager {
+    const char *install;
+    const char *install_stale;
+    const char *lists_dir;
+    const char *lists_suffix;
+};
+
+static const struct PackageManager apt_manager = {
+    "apt-get install -y", "apt-get update && apt-get install -y",
+    "/var/lib/apt/lists", "_Packages"
+};
+static const struct PackageManager dnf_manager = {
+    "dnf install -y", "dnf install -y", NULL, NULL
+};
+static const struct PackageManager yum_manager = {
+    "yum install -y", "yum install -y", NULL, NULL
+};
+static const struct PackageManager pacman_manager = {
+    "pacman -S --needed --noconfirm", "pacman -Syu --needed --noconfirm",
+    "/var/lib/pacman/sync", ".db"
+};
+
+// External commands the installer runs, and the package providing each.
+static const struct {
+    const char *command;
+    const char *package;
+} dependencies[] = {
+    { "fc-cache", "fontconfig" },
+};
+
+// Variant filter for `prune`: comma-separated, case-insensitive lists.
+struct PruneFilter {
+    const char *spacing;  // "default", "mono", "propo"
+    const char *formats;  // "ttf", "otf"
+    const char *styles;   // "Regular", "BoldItalic", ...
+};
+
+// ============================================================================
+// SECURITY HELPERS
+// ============================================================================
 
 // mkdir -p equivalent using only syscalls (no system()).
 static int create_directory_secure(const char *path) {
@@ -133,9 +322,25 @@ static void cleanup_zip(void) {
     }
 }
 
-// Full teardown: zip + unique temp dir.  Called at normal exit and on signals.
+// Remove the second copy of a hedged download, if one is being written.
+static void cleanup_hedge(void) {
+    if (current_hedge_path[0] != '\0') {
+        secure_unlink(current_hedge_path);
+        current_hedge_path[0] = '\0';
+    }
+}
+
+// Full teardown: zip, hedge copy, unfinished prefetches + unique temp dir.
+// Called at normal exit and on signals.
 static void full_cleanup(void) {
     cleanup_zip();
+    cleanup_hedge();
+    for (int i = 0; i < PREFETCH_MAX; i++) {
+        if (prefetch_parts[i][0] != '\0') {
+            secure_unlink(prefetch_parts[i]);
+            prefetch_parts[i][0] = '\0';
+        }
+    }
     if (unique_tmp_dir[0] != '\0') {
         // rmdir only succeeds on an empty directory.
         // If a zip was already cleaned up by cleanup_zip(), this should succeed.
@@ -146,7 +351,7 @@ static void full_cleanup(void) {
 }
 
 // Signal handler.
-// NOTE: global char arrays (current_zip_path, unique_tmp_dir) are not
+// NOTE: global char arrays (current_zip_path, unique_tmp_dir, ...) are not
 // sig_atomic_t; this is a best-effort cleanup. A volatile flag + main-loop
 // cleanup would be fully correct but adds significant complexity for a
 // single-threaded CLI tool.
@@ -162,38 +367,345 @@ static void signal_handler(int sig) {
 }
 
 // ============================================================================
-// CORE FUNCTIONS
+// TRACE (Chrome trace-event JSON, viewable in Perfetto or chrome://tracing)
 // ============================================================================
 
-// libcurl write callback.
-// Guards against integer overflow in size*nmemb and caps total response at
-// 100 MB to prevent memory exhaustion from a malicious/broken API response.
-static size_t write_callback(const char *contents, size_t size, size_t nmemb,
-                             void *userp) {
-    struct HTTPResponse *response = (struct HTTPResponse *)userp;
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Append one event.  The file uses the array form, whose closing bracket is
+// optional, and is flushed per event so an interrupted run still loads.
+static void trace_write(json_t *event) {
+    if (!event)
+        return;
+    fputs(trace_events++ > 0 ? ",\n" : "[\n", trace_fp);
+    json_dumpf(event, trace_fp, JSON_COMPACT);
+    fflush(trace_fp);
+    json_decref(event);
+}
 
-    // Overflow check before multiplication
-    if (nmemb > 0 && size > SIZE_MAX / nmemb)
-        return 0;
+static json_t *trace_new_event(const char *name, const char *ph, int lane) {
+    json_t *event = json_object();
+    if (!event)
+        return NULL;
+    json_object_set_new(event, "name", json_string(name));
+    json_object_set_new(event, "ph", json_string(ph));
+    json_object_set_new(event, "pid", json_integer(getpid()));
+    json_object_set_new(event, "tid", json_integer(lane));
+    return event;
+}
 
-    size_t realsize = size * nmemb;
+static void trace_name_lane(int lane, const char *label) {
+    json_t *event = trace_new_event("thread_name", "M", lane);
+    json_t *args = json_object();
+    json_object_set_new(args, "name", json_string(label));
+    json_object_set_new(event, "args", args);
+    trace_write(event);
+}
 
-    // Response size cap — use subtraction to avoid overflow in the comparison
-    // itself: if realsize alone exceeds the limit, or adding it would exceed it.
-    if (realsize > 100UL * 1024UL * 1024UL ||
-        response->size > 100UL * 1024UL * 1024UL - realsize)
-        return 0;
+static int trace_open(const char *path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+                  0644);
+    if (fd == -1)
+        return -1;
+    trace_fp = fdopen(fd, "w");
+    if (!trace_fp) {
+        close(fd);
+        return -1;
+    }
+    trace_epoch = monotonic_seconds();
+
+    json_t *event = trace_new_event("process_name", "M", TRACE_LANE_MAIN);
+    json_t *args = json_object();
+    json_object_set_new(args, "name", json_string("nerdfonts-installer"));
+    json_object_set_new(event, "args", args);
+    trace_write(event);
+    trace_name_lane(TRACE_LANE_MAIN, "main");
+    trace_name_lane(TRACE_LANE_HEDGE, "hedged requests");
+    trace_name_lane(TRACE_LANE_PREFETCH, "prefetch");
+    return 0;
+}
+
+static void trace_close(void) {
+    if (!trace_fp)
+        return;
+    fputs(trace_events > 0 ? "\n]\n" : "[]\n", trace_fp);
+    fclose(trace_fp);
+    trace_fp = NULL;
+}
+
+// Record a complete ("X") event covering [start, end] (monotonic seconds).
+// Takes ownership of args, which may be NULL.
+static void trace_event(const char *name, const char *cat, int lane,
+                        double start, double end, json_t *args) {
+    if (!trace_fp) {
+        json_decref(args);
+        return;
+    }
+    json_t *event = trace_new_event(name, "X", lane);
+    if (!event) {
+        json_decref(args);
+        return;
+    }
+    json_object_set_new(event, "cat", json_string(cat));
+    json_object_set_new(event, "ts", json_real((start - trace_epoch) * 1e6));
+    json_object_set_new(event, "dur",
+                        json_real((end > start ? end - start : 0.0) * 1e6));
+    if (args)
+        json_object_set_new(event, "args", args);
+    trace_write(event);
+}
+
+// A span on the main lane that started at start and ends now.
+static void trace_span(const char *name, const char *cat, double start,
+                       json_t *args) {
+    trace_event(name, cat, TRACE_LANE_MAIN, start, monotonic_seconds(), args);
+}
 
-    char *ptr = realloc(response->memory, response->size + realsize + 1);
-    if (!ptr)
+// libcurl's phase timings add up across redirect hops.  While tracing, a
+// header callback snapshots them as each redirect response arrives, so the
+// final hop's phases can be shown on their own.
+static size_t trace_header_callback(char *buffer, size_t size, size_t nitems,
+                                    void *userdata) {
+    struct TraceHops *hops = userdata;
+    long code = 0;
+    if (nitems == 2 && buffer[0] == '\r' &&
+        curl_easy_getinfo(hops->curl, CURLINFO_RESPONSE_CODE, &code) ==
+            CURLE_OK && code >= 300 && code < 400) {
+        curl_easy_getinfo(hops->curl, CURLINFO_NAMELOOKUP_TIME_T, &hops->dns);
+        curl_easy_getinfo(hops->curl, CURLINFO_CONNECT_TIME_T, &hops->connect);
+        curl_easy_getinfo(hops->curl, CURLINFO_APPCONNECT_TIME_T, &hops->tls);
+        curl_easy_getinfo(hops->curl, CURLINFO_PRETRANSFER_TIME_T, &hops->pre);
+        curl_easy_getinfo(hops->curl, CURLINFO_STARTTRANSFER_TIME_T,
+                          &hops->ttfb);
+    }
+    return size * nitems;
+}
+
+static void trace_watch(CURL *curl, struct TraceHops *hops) {
+    memset(hops, 0, sizeof(*hops));
+    hops->curl = curl;
+    if (!trace_fp)
+        return;
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, trace_header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, hops);
+}
+
+// libcurl's time for one phase of the final hop, in seconds.
+static double trace_phase(CURL *curl, CURLINFO info, curl_off_t before) {
+    curl_off_t total = 0;
+    curl_easy_getinfo(curl, info, &total);
+    return total > before ? (double)(total - before) / 1e6 : 0.0;
+}
+
+// Record a finished (or cancelled) curl transfer that began at start: one
+// span for the request, labelled with its outcome, with the final hop's
+// timings nested under it as dns, connect, tls, wait (time to first byte)
+// and receive, preceded by a redirect span when the request was redirected.
+static void trace_transfer(const struct TraceHops *hops, int lane,
+                           double start, const char *outcome) {
+    if (!trace_fp)
+        return;
+
+    CURL *curl = hops->curl;
+    double end = monotonic_seconds();
+    curl_off_t redirect = 0, bytes = 0;
+    long http_code = 0;
+    const char *url = NULL, *method = NULL;
+    curl_easy_getinfo(curl, CURLINFO_REDIRECT_TIME_T, &redirect);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &bytes);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+    curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_METHOD, &method);
+
+    const char *file = url ? strrchr(url, '/') : NULL;
+    char name[MAX_PATH_LEN];
+    snprintf(name, sizeof(name), "%s %s", method ? method : "GET",
+             file && file[1] ? file + 1 : "/");
+
+    json_t *args = json_object();
+    json_object_set_new(args, "url", json_string(url ? url : ""));
+    json_object_set_new(args, "status", json_integer(http_code));
+    json_object_set_new(args, "bytes", json_integer(bytes));
+    json_object_set_new(args, "result", json_string(outcome));
+    trace_event(name, "http", lane, start, end, args);
+
+    double hop = start;
+    if (redirect > 0) {
+        hop += (double)redirect / 1e6;
+        trace_event("redirect", "http", lane, start, hop, NULL);
+    }
+
+    // Phases the transfer never reached report no time and are skipped.
+    double dns     = trace_phase(curl, CURLINFO_NAMELOOKUP_TIME_T, hops->dns);
+    double connect = trace_phase(curl, CURLINFO_CONNECT_TIME_T, hops->connect);
+    double tls     = trace_phase(curl, CURLINFO_APPCONNECT_TIME_T, hops->tls);
+    double pre     = trace_phase(curl, CURLINFO_PRETRANSFER_TIME_T, hops->pre);
+    double ttfb    = trace_phase(curl, CURLINFO_STARTTRANSFER_TIME_T,
+                                 hops->ttfb);
+    if (dns > 0.0)
+        trace_event("dns", "http", lane, hop, hop + dns, NULL);
+    if (connect > dns)
+        trace_event("connect", "http", lane, hop + dns, hop + connect, NULL);
+    if (tls > connect)
+        trace_event("tls", "http", lane, hop + connect, hop + tls, NULL);
+    if (ttfb > pre)
+        trace_event("wait", "http", lane, hop + pre, hop + ttfb, NULL);
+    if (ttfb > 0.0 && end > hop + ttfb)
+        trace_event("receive", "http", lane, hop + ttfb, end, NULL);
+}
+
+// ============================================================================
+// DIGESTS
+// ============================================================================
+
+static int sha256_file(const char *path, unsigned char out[SHA256_LEN]) {
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+
+    struct Sha256 ctx;
+    unsigned char buf[65536];
+    ssize_t n;
+
+    sha256_init(&ctx);
+    while ((n = read(fd, buf, sizeof(buf))) != 0) { // flawfinder: ignore
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            close(fd);
+            return -1;
+        }
+        sha256_update(&ctx, buf, (size_t)n);
+    }
+    close(fd);
+    sha256_final(&ctx, out);
+    return 0;
+}
+
+// An unknown (NULL) digest always matches.
+static int file_matches_digest(const char *path, const unsigned char *digest) {
+    unsigned char actual[SHA256_LEN];
+    if (!digest)
+        return 1;
+    double started = monotonic_seconds();
+    int ok = sha256_file(path, actual) == 0 &&
+             memcmp(actual, digest, SHA256_LEN) == 0;
+    trace_span("verify sha256", "disk", started, NULL);
+    return ok;
+}
+
+// ============================================================================
+// CORE FUNCTIONS
+// ============================================================================
+
+// Transient failures worth another attempt: network errors, stalls, 408,
+// 429 and 5xx.  A 403 is retried only when the server sent Retry-After
+// (GitHub's rate limiting); otherwise it is an access problem.
+static int should_retry(CURLcode res, long http_code, long retry_after) {
+    switch (res) {
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_PARTIAL_FILE:
+    case CURLE_RANGE_ERROR:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+    case CURLE_GOT_NOTHING:
+    case CURLE_SSL_CONNECT_ERROR:
+    case CURLE_HTTP2:
+    case CURLE_HTTP2_STREAM:
+        return 1;
+    case CURLE_HTTP_RETURNED_ERROR:
+        return http_code == 408 || http_code == 429 || http_code >= 500 ||
+               (http_code == 403 && retry_after > 0);
+    default:
         return 0;
+    }
+}
+
+// xorshift64*; only used to spread retries, not for anything secret.
+static uint64_t jitter_random(void) {
+    static uint64_t state = 0;
+    if (state == 0) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        state = ((uint64_t)ts.tv_nsec << 20) ^ (uint64_t)ts.tv_sec ^
+                ((uint64_t)getpid() << 40) ^ 0x9e3779b97f4a7c15ULL;
+    }
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dULL;
+}
+
+// Delay before retry number attempt+1: the server's Retry-After when given
+// (or -1 if that is longer than we are willing to wait), otherwise
+// exponential backoff with full jitter.
+static long backoff_delay_ms(int attempt, long retry_after) {
+    if (retry_after > 0)
+        return retry_after <= RETRY_AFTER_MAX ? retry_after * 1000L : -1;
+
+    long cap = BACKOFF_BASE_MS << (attempt < 6 ? attempt : 6);
+    if (cap > BACKOFF_MAX_MS)
+        cap = BACKOFF_MAX_MS;
+    return BACKOFF_BASE_MS / 2 +
+           (long)(jitter_random() % (uint64_t)(cap - BACKOFF_BASE_MS / 2 + 1));
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+        ;
+}
+
+// Cap curl at its part of --max-rate when `share` transfers run at once.
+// libcurl paces the handle itself, without blocking the multi loop (or the
+// prompt it polls alongside), so the cap is split rather than drawn from one
+// bucket.
+static void rate_share(CURL *curl, int share) {
+    if (max_rate > 0 && share > 0)
+        curl_easy_setopt(curl, CURLOPT_MAX_RECV_SPEED_LARGE,
+                         (curl_off_t)(max_rate / (uint64_t)share));
+}
+
+// --idle: drop to the lowest CPU priority and the idle I/O class, so the
+// caller only gets the disk and CPU when nothing else wants them.
+// Niceness cannot be raised again, so this is only called in the child
+// processes that extract archives and run fc-cache.  Best effort: a kernel
+// without ioprio_set() just runs them at normal I/O priority.
+static void lower_priority(void) {
+    int unused = setpriority(PRIO_PROCESS, 0, IDLE_NICE);
+#ifdef SYS_ioprio_set
+    unused |= (int)syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+                           IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+#endif
+    (void)unused;
+}
 
-    response->memory = ptr;
-    memcpy(&(response->memory[response->size]), contents, realsize); // flawfinder: ignore
-    response->size += realsize;
-    response->memory[response->size] = '\0';
+// Let an easy handle reuse the connections, DNS entries and TLS sessions of
+// earlier transfers, including those warmed up during the font prompt.
+static void share_connections(CURL *curl) {
+    if (curl_share)
+        curl_easy_setopt(curl, CURLOPT_SHARE, curl_share);
+}
 
-    return realsize;
+// Human-readable byte count ("512 B", "3.4 MiB").
+static void format_size(uint64_t bytes, char *out, size_t out_size) {
+    static const char *units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double value = (double)bytes;
+    size_t unit = 0;
+    while (value >= 1024.0 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+        value /= 1024.0;
+        unit++;
+    }
+    if (unit == 0)
+        snprintf(out, out_size, "%llu B", (unsigned long long)bytes);
+    else
+        snprintf(out, out_size, "%.1f %s", value, units[unit]);
 }
 
 // PATH-based command existence check (no system() or popen()).
@@ -220,37 +732,12 @@ static int command_exists(const char *command) {
     return 0;
 }
 
-// unzip via fork/exec — no system() shell.
-static int secure_unzip(const char *zip_file, const char *dest_dir) {
-    pid_t pid = fork();
-    if (pid == -1) {
-        perror("fork");
-        return -1;
-    }
-
-    if (pid == 0) {
-        // Silence output in child
-        int devnull = open("/dev/null", O_WRONLY);
-        if (devnull != -1) {
-            dup2(devnull, STDOUT_FILENO);
-            dup2(devnull, STDERR_FILENO);
-            close(devnull);
-        }
-        execlp("unzip", "unzip", "-o", zip_file, "-d", dest_dir, (char *)NULL); // flawfinder: ignore
-        _exit(127);
-    }
-
-    int status;
-    waitpid(pid, &status, 0);
-    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
-}
-
-// Read /etc/os-release and return the appropriate package manager command.
-static const char *detect_os_and_get_package_manager(void) {
+// Read /etc/os-release and return the matching package manager.
+static const struct PackageManager *detect_package_manager(void) {
     FILE *fp = fopen("/etc/os-release", "r");
     if (!fp) {
-        printf("%s", COLOR_RED "OS detection failed. Please install curl, "
-               "unzip, and fontconfig manually.\n" COLOR_RESET);
+        printf("%s", COLOR_RED "OS detection failed. Please install "
+               "fontconfig manually.\n" COLOR_RESET);
         exit(1);
     }
 
@@ -278,32 +765,94 @@ static const char *detect_os_and_get_package_manager(void) {
         strcmp(os_id, "linuxmint") == 0 || strcmp(os_id, "kali")     == 0 ||
         strcmp(os_id, "deepin")    == 0 || strcmp(os_id, "devuan")   == 0 ||
         strcmp(os_id, "mx")        == 0 || strcmp(os_id, "pop")      == 0)
-        return "sudo apt-get update && sudo apt-get install -y";
+        return &apt_manager;
 
     if (strcmp(os_id, "fedora") == 0)
-        return "sudo dnf install -y";
+        return &dnf_manager;
 
     if (strcmp(os_id, "centos") == 0 || strcmp(os_id, "rhel")   == 0 ||
         strcmp(os_id, "rocky")  == 0 || strcmp(os_id, "almalinux") == 0)
-        return "sudo yum install -y";
+        return &yum_manager;
 
     if (strcmp(os_id, "arch")        == 0 || strcmp(os_id, "manjaro") == 0 ||
         strcmp(os_id, "endeavouros") == 0 || strcmp(os_id, "cachyos") == 0 ||
         strcmp(os_id, "garuda")      == 0 || strcmp(os_id, "artix")   == 0 ||
         strcmp(os_id, "arco")        == 0 || strcmp(os_id, "steamos") == 0 ||
         strcmp(os_id, "blackarch")   == 0 || strcmp(os_id, "omarchy") == 0)
-        return "sudo pacman -Syu --noconfirm";
+        return &pacman_manager;
 
     printf("%sUnsupported OS: %s\n%s", COLOR_RED, os_id, COLOR_RESET);
     exit(1);
 }
 
-// Install a single package via the detected package manager.
-// Uses sh -c only because the package_manager string contains && for apt-get;
-// both package_manager and package are hardcoded strings within this program.
-static void install_package(const char *package_manager, const char *package) {
-    printf("%s%s not found. Installing %s...\n" COLOR_RESET, // flawfinder: ignore
-           COLOR_YELLOW, package, package);
+// Were the package lists refreshed within PKG_LISTS_MAX_AGE?  Judged by the
+// newest list file, so a lists directory emptied by an image build (as
+// Docker images do) counts as stale.
+static int package_lists_fresh(const struct PackageManager *pm) {
+    if (!pm->lists_dir)
+        return 0;
+    DIR *dir = opendir(pm->lists_dir);
+    if (!dir)
+        return 0;
+
+    size_t suffix_len = strlen(pm->lists_suffix); // flawfinder: ignore
+    time_t newest = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        size_t len = strlen(ent->d_name); // flawfinder: ignore
+        char path[MAX_PATH_LEN];
+        struct stat st;
+        if (len <= suffix_len ||
+            strcmp(ent->d_name + len - suffix_len, pm->lists_suffix) != 0 ||
+            snprintf(path, sizeof(path), "%s/%s", pm->lists_dir,
+                     ent->d_name) >= (int)sizeof(path) ||
+            stat(path, &st) != 0)
+            continue;
+        if (st.st_mtime > newest)
+            newest = st.st_mtime;
+    }
+    closedir(dir);
+    return newest > 0 && time(NULL) - newest < PKG_LISTS_MAX_AGE;
+}
+
+// Install all of packages in one package-manager transaction, refreshing
+// the package lists first only when they are stale.  Runs under sudo
+// unless we already are root.  Packages reach the shell as "$@", never
+// spliced into the command string.
+static void install_packages(const struct PackageManager *pm,
+                             const char *const *packages, size_t count) {
+    int fresh = package_lists_fresh(pm);
+    int as_root = geteuid() == 0;
+
+    printf("%sInstalling missing packages:", COLOR_YELLOW);
+    for (size_t i = 0; i < count; i++)
+        printf(" %s", packages[i]);
+    printf("%s\n%s", fresh ? " (package lists are fresh)" : "", COLOR_RESET);
+
+    if (!as_root && !command_exists("sudo")) {
+        printf("%s", COLOR_RED "Error: sudo not found; run as root or install "
+               "the packages above manually.\n" COLOR_RESET);
+        exit(1);
+    }
+
+    char script[MAX_COMMAND_LEN];
+    snprintf(script, sizeof(script), "%s \"$@\"",
+             fresh ? pm->install : pm->install_stale);
+
+    const char **args = calloc(count + 6, sizeof(*args));
+    if (!args) {
+        printf("%s", COLOR_RED "Error: Out of memory\n" COLOR_RESET);
+        exit(1);
+    }
+    size_t n = 0;
+    if (!as_root)
+        args[n++] = "sudo";
+    args[n++] = "sh";
+    args[n++] = "-c";
+    args[n++] = script;
+    args[n++] = "sh";
+    for (size_t i = 0; i < count; i++)
+        args[n++] = packages[i];
 
     pid_t pid = fork();
     if (pid == -1) {
@@ -312,37 +861,43 @@ static void install_package(const char *package_manager, const char *package) {
     }
 
     if (pid == 0) {
-        char cmd[MAX_COMMAND_LEN];
-        snprintf(cmd, sizeof(cmd), "%s %s", package_manager, package);
-        execlp("sh", "sh", "-c", cmd, (char *)NULL); // flawfinder: ignore
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-qual"
+        execvp(args[0], (char *const *)args); // flawfinder: ignore
+#pragma GCC diagnostic pop
         _exit(127);
     }
 
+    free(args);
     int status;
     waitpid(pid, &status, 0);
     if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
-        printf("%sFailed to install %s\n%s", COLOR_RED, package, COLOR_RESET);
+        printf("%s", COLOR_RED "Failed to install dependencies\n"
+               COLOR_RESET);
         exit(1);
     }
 }
 
-// Check and install curl, unzip, fontconfig if missing.
+// Install whatever external tools are missing.  Downloads go through
+// libcurl and extraction through zlib, so only fc-cache is needed.
 static void install_dependencies(void) {
-    const char *pkg_manager = detect_os_and_get_package_manager();
+    const char *missing[sizeof(dependencies) / sizeof(dependencies[0])];
+    size_t nmissing = 0;
+
+    for (size_t i = 0; i < sizeof(dependencies) / sizeof(dependencies[0]); i++) {
+        if (!command_exists(dependencies[i].command))
+            missing[nmissing++] = dependencies[i].package;
+    }
 
-    if (!command_exists("curl"))
-        install_package(pkg_manager, "curl");
-    if (!command_exists("unzip"))
-        install_package(pkg_manager, "unzip");
-    if (!command_exists("fc-cache"))
-        install_package(pkg_manager, "fontconfig");
+    if (nmissing > 0)
+        install_packages(detect_package_manager(), missing, nmissing);
 
     printf("%s", COLOR_GREEN "✓ All dependencies are installed\n" COLOR_RESET);
 }
 
-// Create fonts dir and a unique temp dir via mkdtemp().
-// Temp dir priority: $TMPDIR -> /tmp -> ~/tmp (last resort).
-static void create_directories(void) {
+// Resolve fonts_path and cache_path from $HOME / $XDG_CACHE_HOME.
+// Returns $HOME; exits if it is unset or too long for derived paths.
+static const char *resolve_user_paths(void) {
     const char *home = getenv("HOME"); // flawfinder: ignore
     if (!home) {
         printf("%s", COLOR_RED "Error: Could not get HOME directory\n"
@@ -361,15 +916,35 @@ static void create_directories(void) {
 
     snprintf(fonts_path, sizeof(fonts_path), "%s/.local/share/fonts", home);
 
-    const char *env_tmp = getenv("TMPDIR"); // flawfinder: ignore
-    if (env_tmp && strlen(env_tmp) > 0 && // flawfinder: ignore
-        strlen(env_tmp) + sizeof(MKDTEMP_SUFFIX) <= sizeof(tmp_path)) { // flawfinder: ignore
-        snprintf(tmp_path, sizeof(tmp_path), "%s", env_tmp);
-    } else if (access("/tmp", W_OK) == 0) { // flawfinder: ignore
-        snprintf(tmp_path, sizeof(tmp_path), "/tmp");
-    } else {
-        snprintf(tmp_path, sizeof(tmp_path), "%s/tmp", home);
-    }
+    // Release index and other cached state live under the XDG cache dir.
+    const char *xdg_cache = getenv("XDG_CACHE_HOME"); // flawfinder: ignore
+    if (xdg_cache && xdg_cache[0] == '/' &&
+        strlen(xdg_cache) < MAX_PATH_LEN - 50) // flawfinder: ignore
+        snprintf(cache_path, sizeof(cache_path), "%s/nerdfonts-installer",
+                 xdg_cache);
+    else
+        snprintf(cache_path, sizeof(cache_path),
+                 "%s/.cache/nerdfonts-installer", home);
+
+    return home;
+}
+
+// Create the fonts and cache dirs.  The temp dir is chosen later, once the
+// selection is known (see preflight_disk_space).
+static void create_directories(void) {
+    resolve_user_paths();
+
+    // EEXIST is normal for returning users; create_directory_secure already
+    // handles it silently. Any other failure is non-fatal: fonts may still
+    // install if the directory was created by another means, so the return
+    // value is intentionally discarded here.
+    (void)create_directory_secure(fonts_path);
+    (void)create_directory_secure(cache_path);
+}
+
+// Create the unique temp dir under base via mkdtemp().
+static void create_temp_dir(const char *base) {
+    snprintf(tmp_path, sizeof(tmp_path), "%s", base);
 
     // Explicit bounds check before building the mkdtemp template.
     if (strlen(tmp_path) + sizeof(MKDTEMP_SUFFIX) > sizeof(unique_tmp_dir)) { // flawfinder: ignore
@@ -388,149 +963,777 @@ static void create_directories(void) {
     }
 
     if (mkdtemp(unique_tmp_dir) == NULL) {
-        printf("%s", COLOR_RED "Error: Failed to create unique temp "
-               "directory\n" COLOR_RESET);
+        printf("%sError: Failed to create unique temp directory in %s\n%s",
+               COLOR_RED, tmp_path, COLOR_RESET);
+        unique_tmp_dir[0] = '\0';
         exit(1);
     }
+}
 
-    // EEXIST is normal for returning users; create_directory_secure already
-    // handles it silently. Any other failure is non-fatal: fonts may still
-    // install if the directory was created by another means, so the return
-    // value is intentionally discarded here.
-    (void)create_directory_secure(fonts_path);
+// ============================================================================
+// RELEASE INDEX
+// ============================================================================
+
+// Parse a GitHub timestamp ("2024-04-23T14:03:11Z") into seconds since the
+// epoch, without relying on the process time zone.  Returns 0 on error.
+static uint32_t parse_iso8601(const char *ts) {
+    int y, mo, d, h, mi, sec;
+    if (!ts || sscanf(ts, "%4d-%2d-%2dT%2d:%2d:%2dZ", // flawfinder: ignore
+                      &y, &mo, &d, &h, &mi, &sec) != 6 ||
+        y < 1970 || y > 2105 || mo < 1 || mo > 12 || d < 1 || d > 31 ||
+        h > 23 || mi > 59 || sec > 60)
+        return 0;
+
+    // Days from civil date (H. Hinnant's algorithm).
+    y -= mo <= 2;
+    long era = y / 400;
+    long yoe = y - era * 400;
+    long doy = (153 * (mo + (mo > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long days = era * 146097 + doe - 719468;
+
+    return (uint32_t)(days * 86400L + h * 3600L + mi * 60L + sec);
 }
 
-// Fetch available fonts from the GitHub Releases API and populate fonts[].
-static void fetch_available_fonts(void) {
-    CURL *curl;
-    CURLcode res;
-    struct HTTPResponse response = {0};
+static const struct IndexHeader *index_header(void) {
+    return (const struct IndexHeader *)(const void *)index_map;
+}
 
-    printf("%s", COLOR_YELLOW "Fetching available fonts from GitHub...\n"
-           COLOR_RESET);
+static const struct IndexRelease *index_releases(void) {
+    return (const struct IndexRelease *)(const void *)
+        (index_map + sizeof(struct IndexHeader));
+}
 
-    curl = curl_easy_init();
-    if (!curl) {
-        printf("%s", COLOR_RED "Failed to initialize curl\n" COLOR_RESET);
-        exit(1);
-    }
+static const struct IndexAsset *index_assets(void) {
+    return (const struct IndexAsset *)(const void *)
+        ((const unsigned char *)(index_releases() +
+                                 index_header()->release_count));
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, API_URL);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "nerdfonts-installer/1.0");
-    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    // Treat 4xx/5xx as curl errors so rate-limit responses don't reach the
-    // JSON parser as if they were valid release data.
-    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+static const char *index_string(uint32_t off) {
+    const unsigned char *strings = (const unsigned char *)
+        (index_assets() + index_header()->asset_count);
+    return (const char *)(strings + off);
+}
 
-    res = curl_easy_perform(curl);
+// Bounds-check every record so lookups never need to re-validate.
+// The string table must end in NUL, which makes any in-range offset a
+// terminated string.
+static int index_validate(const unsigned char *map, size_t len) {
+    if (len < sizeof(struct IndexHeader))
+        return 0;
 
-    // Retrieve HTTP code before cleanup invalidates the handle.
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-    curl_easy_cleanup(curl);
+    const struct IndexHeader *h = (const struct IndexHeader *)(const void *)map;
+    if (h->magic != INDEX_MAGIC || h->version != INDEX_VERSION)
+        return 0;
 
-    if (res != CURLE_OK) {
-        free(response.memory);
-        response.memory = NULL;
-        if (res == CURLE_HTTP_RETURNED_ERROR &&
-            (http_code == 403 || http_code == 429)) {
-            printf("%sFailed to fetch font list: HTTP %ld (rate-limited).\n"
-                   "Set GITHUB_TOKEN in your environment to raise the limit:\n"
-                   "  export GITHUB_TOKEN=ghp_...\n%s",
-                   COLOR_RED, http_code, COLOR_RESET);
-        } else {
-            printf("%sFailed to fetch font list from GitHub API: %s\n%s",
-                   COLOR_RED, curl_easy_strerror(res), COLOR_RESET);
-        }
-        exit(1);
-    }
+    uint64_t expected = sizeof(struct IndexHeader) +
+        (uint64_t)h->release_count * sizeof(struct IndexRelease) +
+        (uint64_t)h->asset_count * sizeof(struct IndexAsset) +
+        h->strings_size;
+    if (expected != len || h->strings_size == 0 || map[len - 1] != '\0')
+        return 0;
 
-    if (!response.memory || response.size == 0) {
-        printf("%s", COLOR_RED "Empty response from GitHub API\n" COLOR_RESET);
-        free(response.memory);
-        exit(1);
+    const struct IndexRelease *rel = (const struct IndexRelease *)(const void *)
+        (map + sizeof(struct IndexHeader));
+    const struct IndexAsset *assets = (const struct IndexAsset *)(const void *)
+        (rel + h->release_count);
+
+    for (uint32_t i = 0; i < h->release_count; i++) {
+        if (rel[i].tag_off >= h->strings_size ||
+            (uint64_t)rel[i].first_asset + rel[i].asset_count > h->asset_count)
+            return 0;
+    }
+    for (uint32_t i = 0; i < h->asset_count; i++) {
+        if (assets[i].name_off >= h->strings_size)
+            return 0;
     }
+    return 1;
+}
 
-    json_error_t error;
-    json_t *root = json_loads(response.memory, 0, &error);
-    free(response.memory);
-    response.memory = NULL;
+static int index_file_path(char *out, size_t out_size) {
+    int n = snprintf(out, out_size, "%s/%s", cache_path, INDEX_FILE_NAME);
+    return n > 0 && (size_t)n < out_size;
+}
 
-    if (!root) {
-        printf("%sJSON parsing error: %s\n%s",
-               COLOR_RED, error.text, COLOR_RESET);
-        exit(1);
+static void close_release_index(void) {
+    if (index_map) {
+        munmap(index_map, index_map_len);
+        index_map = NULL;
+        index_map_len = 0;
     }
+}
 
-    // Releases API returns an object ({...}), not an array ([...]).
-    if (!json_is_object(root)) {
-        printf("%s", COLOR_RED
-               "Invalid JSON response format (expected release object)\n"
-               COLOR_RESET);
-        json_decref(root);
-        exit(1);
-    }
+// mmap the release index read-only.  A missing index is normal on first run;
+// a corrupt one is ignored and rewritten on the next catalog fetch.
+static void open_release_index(void) {
+    char path[MAX_PATH_LEN];
+    if (!index_file_path(path, sizeof(path)))
+        return;
 
-    json_t *assets = json_object_get(root, "assets");
-    if (!json_is_array(assets)) {
-        printf("%s", COLOR_RED
-               "Invalid JSON: missing or malformed 'assets' array\n"
-               COLOR_RESET);
-        json_decref(root);
-        exit(1);
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1)
+        return;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+        (uint64_t)st.st_size > INDEX_MAX_BYTES) {
+        close(fd);
+        return;
     }
 
-    size_t index;
-    json_t *value;
-    font_count = 0;
+    size_t len = (size_t)st.st_size;
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return;
 
-    json_array_foreach(assets, index, value) {
-        if (font_count >= MAX_FONTS) {
-            printf("%sWarning: font limit (%d) reached; some fonts omitted.\n"
-                   "%s", COLOR_YELLOW, MAX_FONTS, COLOR_RESET);
-            break;
+    if (!index_validate(map, len)) {
+        // An index written by another format version is simply rebuilt.
+        const struct IndexHeader *h = map;
+        if (len < sizeof(*h) || h->magic != INDEX_MAGIC ||
+            h->version == INDEX_VERSION)
+            printf("%s", COLOR_YELLOW "Warning: Ignoring corrupt release "
+                   "index\n" COLOR_RESET);
+        munmap(map, len);
+        return;
+    }
+
+    index_map = map;
+    index_map_len = len;
+}
+
+static const struct IndexRelease *index_find_release(const char *tag) {
+    if (!index_map)
+        return NULL;
+
+    const struct IndexRelease *rel = index_releases();
+    for (uint32_t i = 0; i < index_header()->release_count; i++) {
+        if (strcmp(index_string(rel[i].tag_off), tag) == 0)
+            return &rel[i];
+    }
+    return NULL;
+}
+
+static const struct IndexRelease *index_latest_release(void) {
+    if (!index_map || index_header()->release_count == 0)
+        return NULL;
+
+    const struct IndexRelease *rel = index_releases();
+    const struct IndexRelease *best = &rel[0];
+    for (uint32_t i = 1; i < index_header()->release_count; i++) {
+        if (rel[i].published > best->published)
+            best = &rel[i];
+    }
+    return best;
+}
+
+static int write_all(int fd, const void *buf, size_t len) {
+    const unsigned char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
         }
+        p   += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Releases with an unknown date are taken as settled.
+static int index_release_settled(const struct IndexRelease *rel) {
+    return rel->published == 0 ||
+           time(NULL) - (time_t)rel->published >= RELEASE_SETTLE_SECS;
+}
 
-        json_t *name_obj = json_object_get(value, "name");
-        if (!json_is_string(name_obj))
+// Does a GitHub release object list other font assets, sizes or digests
+// than the indexed copy of the release?
+static int index_release_changed(const struct IndexRelease *rel,
+                                 json_t *assets) {
+    const struct IndexAsset *have = index_assets() + rel->first_asset;
+    char bare[MAX_FONT_NAME_LEN];
+    unsigned char sha256[SHA256_LEN];
+    uint32_t seen = 0;
+    size_t idx;
+    json_t *asset;
+
+    json_array_foreach(assets, idx, asset) {
+        if (!asset_font_name(asset, bare, sizeof(bare)))
             continue;
 
-        const char *name = json_string_value(name_obj);
-        size_t len = strlen(name); // flawfinder: ignore
+        const struct IndexAsset *a = NULL;
+        for (uint32_t i = 0; i < rel->asset_count && !a; i++) {
+            if (strcmp(index_string(have[i].name_off), bare) == 0)
+                a = &have[i];
+        }
+        if (!a)
+            return 1;
+
+        json_t *size_obj = json_object_get(asset, "size");
+        uint64_t size = json_is_integer(size_obj) &&
+                        json_integer_value(size_obj) > 0
+                      ? (uint64_t)json_integer_value(size_obj) : 0;
+        json_t *digest_obj = json_object_get(asset, "digest");
+        int has_digest = json_is_string(digest_obj) &&
+            parse_sha256_digest(json_string_value(digest_obj), sha256);
+        if (size != a->size ||
+            has_digest != ((a->flags & ASSET_HAS_DIGEST) != 0) ||
+            (has_digest && memcmp(sha256, a->sha256, SHA256_LEN) != 0))
+            return 1;
+        seen++;
+    }
+    return seen != rel->asset_count;
+}
+
+static int release_listed(json_t *const *releases, size_t count,
+                          const char *tag) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(json_string_value(json_object_get(releases[i], "tag_name")),
+                   tag) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+// Newest first; releases without a publication date sort last.
+static int compare_releases(const void *a, const void *b) {
+    const struct IndexRelease *x = a, *y = b;
+    if (x->published != y->published)
+        return x->published > y->published ? -1 : 1;
+    return x->tag_off > y->tag_off ? -1 : x->tag_off < y->tag_off;
+}
+
+// Rewrite the index with the given GitHub release objects added to the
+// releases already mapped.  Tags that are already indexed are skipped unless
+// their assets changed (a release fetched while its assets were still being
+// uploaded), so a refresh only costs new or completed releases.  The
+// existing string table and asset records are carried over verbatim
+// (offsets stay valid); a replaced release leaves its old assets and
+// strings behind unreferenced.  The new file replaces the old one
+// atomically via rename().  The caller holds the index lock.
+static int index_merge_locked(json_t *const *releases, size_t count) {
+    const struct IndexHeader *old = index_map ? index_header() : NULL;
+    uint32_t old_releases = old ? old->release_count : 0;
+    uint32_t old_assets   = old ? old->asset_count   : 0;
+    uint32_t old_strings  = old ? old->strings_size  : 0;
+
+    // Pass 1: pick the releases to add and size the new file.
+    json_t **fresh = calloc(count ? count : 1, sizeof(*fresh));
+    if (!fresh)
+        return -1;
+
+    size_t   fresh_count = 0, replaced = 0;
+    uint64_t new_assets = 0, new_strings = 0;
+    char     bare[MAX_FONT_NAME_LEN];
+    char     safe_tag[MAX_TAG_LEN];
 
-        // Must end in ".zip"
-        if (len <= 4 || strcmp(name + len - 4, ".zip") != 0)
+    for (size_t i = 0; i < count; i++) {
+        json_t *tag_obj = json_object_get(releases[i], "tag_name");
+        json_t *assets  = json_object_get(releases[i], "assets");
+        if (!json_is_string(tag_obj) || !json_is_array(assets))
             continue;
 
-        // Exclude the font patcher archive — it is not a font.
-        if (strcmp(name, "FontPatcher.zip") == 0)
+        // Tags share the font-name whitelist; anything else is skipped so
+        // the index only ever holds values that are safe in URLs and paths.
+        const char *tag = json_string_value(tag_obj);
+        const struct IndexRelease *have = index_find_release(tag);
+        if (!sanitize_font_name(tag, safe_tag, sizeof(safe_tag)) ||
+            (have && !index_release_changed(have, assets)) ||
+            release_listed(fresh, fresh_count, tag))
             continue;
 
-        // Strip .zip suffix; download_and_install_font() re-appends it.
-        size_t bare_len = len - 4;
-        if (bare_len >= MAX_FONT_NAME_LEN)
+        if (have)
+            replaced++;
+        fresh[fresh_count++] = releases[i];
+        new_strings += strlen(tag) + 1; // flawfinder: ignore
+
+        size_t idx;
+        json_t *asset;
+        json_array_foreach(assets, idx, asset) {
+            if (!asset_font_name(asset, bare, sizeof(bare)))
+                continue;
+            new_assets++;
+            new_strings += strlen(bare) + 1; // flawfinder: ignore
+        }
+    }
+
+    if (fresh_count == 0) {
+        free(fresh);
+        return 0;
+    }
+
+    uint64_t release_total = (uint64_t)old_releases - replaced + fresh_count;
+    uint64_t asset_total   = (uint64_t)old_assets + new_assets;
+    uint64_t strings_total = (uint64_t)old_strings + new_strings;
+    uint64_t file_size = sizeof(struct IndexHeader) +
+                         release_total * sizeof(struct IndexRelease) +
+                         asset_total * sizeof(struct IndexAsset) +
+                         strings_total;
+    if (file_size > INDEX_MAX_BYTES) {
+        free(fresh);
+        return -1;
+    }
+
+    unsigned char *buf = calloc(1, (size_t)file_size);
+    if (!buf) {
+        free(fresh);
+        return -1;
+    }
+
+    struct IndexHeader *h = (struct IndexHeader *)(void *)buf;
+    h->magic         = INDEX_MAGIC;
+    h->version       = INDEX_VERSION;
+    h->release_count = (uint32_t)release_total;
+    h->asset_count   = (uint32_t)asset_total;
+    h->strings_size  = (uint32_t)strings_total;
+
+    struct IndexRelease *rel = (struct IndexRelease *)(void *)
+        (buf + sizeof(struct IndexHeader));
+    struct IndexAsset *assets_out = (struct IndexAsset *)(void *)
+        (rel + release_total);
+    char *strings = (char *)(assets_out + asset_total);
+
+    // Old assets and strings keep their positions; the release records are
+    // sorted by publication date once the new ones are in.
+    if (old) {
+        const struct IndexRelease *kept = index_releases();
+        size_t n = fresh_count;
+        for (uint32_t i = 0; i < old_releases; i++) {
+            if (!release_listed(fresh, fresh_count,
+                                index_string(kept[i].tag_off)))
+                rel[n++] = kept[i];
+        }
+        memcpy(assets_out, index_assets(), // flawfinder: ignore
+               old_assets * sizeof(struct IndexAsset));
+        memcpy(strings, index_string(0), old_strings); // flawfinder: ignore
+    }
+
+    // Pass 2: append the new releases.
+    uint32_t asset_pos  = old_assets;
+    uint32_t string_pos = old_strings;
+
+    for (size_t i = 0; i < fresh_count; i++) {
+        const char *tag = json_string_value(json_object_get(fresh[i], "tag_name"));
+        size_t tag_len = strlen(tag) + 1; // flawfinder: ignore
+
+        rel[i].tag_off     = string_pos;
+        rel[i].first_asset = asset_pos;
+        rel[i].published   = parse_iso8601(json_string_value(
+                                 json_object_get(fresh[i], "published_at")));
+        memcpy(strings + string_pos, tag, tag_len); // flawfinder: ignore
+        string_pos += (uint32_t)tag_len;
+
+        size_t idx;
+        json_t *asset;
+        json_array_foreach(json_object_get(fresh[i], "assets"), idx, asset) {
+            if (!asset_font_name(asset, bare, sizeof(bare)))
+                continue;
+
+            struct IndexAsset *a = &assets_out[asset_pos++];
+            size_t bare_len = strlen(bare) + 1; // flawfinder: ignore
+
+            a->name_off = string_pos;
+            memcpy(strings + string_pos, bare, bare_len); // flawfinder: ignore
+            string_pos += (uint32_t)bare_len;
+
+            json_t *size_obj = json_object_get(asset, "size");
+            if (json_is_integer(size_obj) && json_integer_value(size_obj) > 0)
+                a->size = (uint64_t)json_integer_value(size_obj);
+
+            json_t *digest_obj = json_object_get(asset, "digest");
+            if (json_is_string(digest_obj) &&
+                parse_sha256_digest(json_string_value(digest_obj), a->sha256))
+                a->flags |= ASSET_HAS_DIGEST;
+        }
+        rel[i].asset_count = asset_pos - rel[i].first_asset;
+    }
+    free(fresh);
+    qsort(rel, (size_t)release_total, sizeof(*rel), compare_releases);
+
+    char path[MAX_PATH_LEN], tmp[MAX_PATH_LEN];
+    if (!index_file_path(path, sizeof(path)) ||
+        snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid()) >=
+            (int)sizeof(tmp)) {
+        free(buf);
+        return -1;
+    }
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+                  0644);
+    if (fd == -1) {
+        free(buf);
+        return -1;
+    }
+
+    int ok = write_all(fd, buf, (size_t)file_size) == 0 && fsync(fd) == 0;
+    free(buf);
+    if (close(fd) != 0 || !ok || rename(tmp, path) != 0) {
+        secure_unlink(tmp);
+        return -1;
+    }
+
+    close_release_index();
+    open_release_index();
+    return (int)fresh_count;
+}
+
+// index_merge_locked() under an fcntl() lock on <index>.lock.  Serve workers
+// and other installers may merge at the same time; each re-reads the index
+// once it holds the lock, so no merge is built on a stale copy and lost.
+static int index_merge_releases(json_t *const *releases, size_t count) {
+    char path[MAX_PATH_LEN], lock_path[MAX_PATH_LEN];
+    if (!index_file_path(path, sizeof(path)) ||
+        snprintf(lock_path, sizeof(lock_path), "%s.lock", path) >=
+            (int)sizeof(lock_path))
+        return -1;
+
+    int lock_fd = open(lock_path, O_WRONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC,
+                       0600);
+    if (lock_fd == -1)
+        return -1;
+
+    struct flock fl = {0};
+    fl.l_type   = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    while (fcntl(lock_fd, F_SETLKW, &fl) == -1 && errno == EINTR)
+        ;
+
+    close_release_index();
+    open_release_index();
+    int rc = index_merge_locked(releases, count);
+
+    close(lock_fd); // releases the lock
+    return rc;
+}
+
+// ============================================================================
+// CATALOG
+// ============================================================================
+
+// GET a GitHub API (or mirror) URL and parse the body as JSON.
+// Returns NULL on transport, HTTP or parse errors, printing a diagnostic
+// unless quiet is set.
+static json_t *fetch_json(const char *url, int quiet) {
+    CURL *curl;
+    CURLcode res;
+    struct HTTPResponse response = {0};
+
+    curl = curl_easy_init();
+    if (!curl) {
+        printf("%s", COLOR_RED "Failed to initialize curl\n" COLOR_RESET);
+        return NULL;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
+    share_connections(curl);
+    rate_share(curl, 1);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "nerdfonts-installer/1.0");
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    // Treat 4xx/5xx as curl errors so rate-limit responses don't reach the
+    // JSON parser as if they were valid release data.
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+
+    // Quiet fetches are mirror probes: fail over to GitHub rather than retry.
+    long http_code = 0;
+    for (int attempt = 0;; attempt++) {
+        struct TraceHops hops;
+        trace_watch(curl, &hops);
+        double started = monotonic_seconds();
+        res = curl_easy_perform(curl);
+        trace_transfer(&hops, TRACE_LANE_MAIN, started,
+                       curl_easy_strerror(res));
+
+        // Retrieve HTTP code before cleanup invalidates the handle.
+        curl_off_t retry_after = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+        curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retry_after);
+
+        if (res == CURLE_OK || quiet || attempt >= max_retries ||
+            !should_retry(res, http_code, (long)retry_after))
+            break;
+
+        long delay = backoff_delay_ms(attempt, (long)retry_after);
+        if (delay < 0)
+            break;
+        if (res == CURLE_HTTP_RETURNED_ERROR)
+            printf("%sCatalog request failed (HTTP %ld); retrying in %.1fs\n%s",
+                   COLOR_YELLOW, http_code, (double)delay / 1000.0,
+                   COLOR_RESET);
+        else
+            printf("%sCatalog request failed (%s); retrying in %.1fs\n%s",
+                   COLOR_YELLOW, curl_easy_strerror(res),
+                   (double)delay / 1000.0, COLOR_RESET);
+        double slept = monotonic_seconds();
+        sleep_ms(delay);
+        trace_span("backoff", "retry", slept, NULL);
+
+        free(response.memory);
+        response.memory = NULL;
+        response.size = 0;
+    }
+    curl_easy_cleanup(curl);
+
+    if (res != CURLE_OK) {
+        free(response.memory);
+        response.memory = NULL;
+        if (quiet)
+            return NULL;
+        if (res == CURLE_HTTP_RETURNED_ERROR &&
+            (http_code == 403 || http_code == 429)) {
+            printf("%sFailed to fetch font list: HTTP %ld (rate-limited).\n"
+                   "Set GITHUB_TOKEN in your environment to raise the limit:\n"
+                   "  export GITHUB_TOKEN=ghp_...\n%s",
+                   COLOR_RED, http_code, COLOR_RESET);
+        } else if (res == CURLE_HTTP_RETURNED_ERROR && http_code == 404) {
+            printf("%sRelease not found on GitHub (HTTP 404)\n%s",
+                   COLOR_RED, COLOR_RESET);
+        } else {
+            printf("%sFailed to fetch font list from GitHub API: %s\n%s",
+                   COLOR_RED, curl_easy_strerror(res), COLOR_RESET);
+        }
+        return NULL;
+    }
+
+    if (!response.memory || response.size == 0) {
+        if (!quiet)
+            printf("%s", COLOR_RED "Empty response from GitHub API\n"
+                   COLOR_RESET);
+        free(response.memory);
+        return NULL;
+    }
+
+    json_error_t error;
+    json_t *root = json_loads(response.memory, 0, &error);
+    free(response.memory);
+    response.memory = NULL;
+
+    if (!root) {
+        if (!quiet)
+            printf("%sJSON parsing error: %s\n%s",
+                   COLOR_RED, error.text, COLOR_RESET);
+        return NULL;
+    }
+    return root;
+}
+
+// Populate the catalog from a release's assets array.
+static void load_fonts_from_assets(const json_t *assets) {
+    if (filter_font_assets(assets, &catalog) > 0)
+        printf("%sWarning: font limit (%d) reached; some fonts omitted.\n"
+               "%s", COLOR_YELLOW, MAX_FONTS, COLOR_RESET);
+}
+
+// Populate the catalog straight from the mapped index; no network, no JSON.
+static void load_fonts_from_index(const struct IndexRelease *rel) {
+    const struct IndexAsset *assets = index_assets() + rel->first_asset;
+    catalog.count = 0;
+
+    for (uint32_t i = 0; i < rel->asset_count; i++) {
+        if (catalog.count >= MAX_FONTS) {
+            printf("%sWarning: font limit (%d) reached; some fonts omitted.\n"
+                   "%s", COLOR_YELLOW, MAX_FONTS, COLOR_RESET);
+            break;
+        }
+
+        const char *name = index_string(assets[i].name_off);
+        if (strlen(name) >= MAX_FONT_NAME_LEN) // flawfinder: ignore
             continue;
 
-        for (size_t i = 0; i < bare_len; i++)
-            fonts[font_count][i] = name[i];
-        fonts[font_count][bare_len] = '\0';
-        font_count++;
+        int n = catalog.count;
+        snprintf(catalog.names[n], MAX_FONT_NAME_LEN, "%s", name);
+        catalog.sizes[n] = assets[i].size;
+        catalog.has_digest[n] = (assets[i].flags & ASSET_HAS_DIGEST) != 0;
+        memcpy(catalog.digests[n], assets[i].sha256, // flawfinder: ignore
+               SHA256_LEN);
+        catalog.count++;
+    }
+}
+
+// Ask the tag API for a release and merge it into the index.  Returns the
+// indexed release afterwards, which is NULL if neither knows the tag.
+static const struct IndexRelease *index_refresh_release(const char *tag) {
+    char url[MAX_PATH_LEN];
+    snprintf(url, sizeof(url), API_BASE_URL "/tags/%s", tag);
+    json_t *root = fetch_json(url, 1);
+    if (root && json_is_object(root))
+        (void)index_merge_releases(&root, 1);
+    if (root)
+        json_decref(root);
+    return index_find_release(tag);
+}
+
+// The mirror is unauthenticated, so the digests it lists would let it vouch
+// for its own archives.  Replace its catalog with the release as GitHub
+// describes it, from the local index or the tag API (which also records it
+// in the index).  If GitHub cannot be asked, the digests are dropped, which
+// keeps fetch_archive() off the mirror.
+static void trust_mirror_catalog(void) {
+    const struct IndexRelease *rel = index_find_release(release_tag);
+
+    if (!rel || !index_release_settled(rel))
+        rel = index_refresh_release(release_tag);
+
+    if (rel) {
+        load_fonts_from_index(rel);
+        return;
+    }
+
+    printf("%s", COLOR_YELLOW "Warning: Could not check the mirror's catalog "
+           "against GitHub; downloading from GitHub\n" COLOR_RESET);
+    for (int i = 0; i < catalog.count; i++)
+        catalog.has_digest[i] = 0;
+}
+
+// Populate the catalog for the pinned release (index first, then the tag API)
+// or for releases/latest, recording any newly seen release in the index.
+static void fetch_available_fonts(void) {
+    char url[MAX_PATH_LEN];
+    char mirror[MAX_PATH_LEN];
+    const char *route;
+
+    if (release_pinned) {
+        const struct IndexRelease *rel = index_find_release(release_tag);
+        if (rel && !index_release_settled(rel))
+            rel = index_refresh_release(release_tag);
+        if (rel) {
+            load_fonts_from_index(rel);
+            if (catalog.count == 0) {
+                printf("%s", COLOR_RED
+                       "No fonts found in the release assets\n" COLOR_RESET);
+                exit(1);
+            }
+            printf("%sFound %d available fonts in %s (local index)\n%s",
+                   COLOR_GREEN, catalog.count, release_tag, COLOR_RESET);
+            return;
+        }
+        snprintf(url, sizeof(url), API_BASE_URL "/tags/%s", release_tag);
+        route = "/releases/tags/";
+    } else {
+        snprintf(url, sizeof(url), API_BASE_URL "/latest");
+        route = "/releases/latest";
+    }
+
+    const char *source = mirror_url[0] != '\0' ? "the mirror" : "GitHub";
+    if (release_pinned)
+        printf("%sFetching release %s from %s...\n%s",
+               COLOR_YELLOW, release_tag, source, COLOR_RESET);
+    else
+        printf("%sFetching available fonts from %s...\n%s",
+               COLOR_YELLOW, source, COLOR_RESET);
+
+    // A mirror answers the same routes as `serve`; fall back to GitHub.
+    json_t *root = NULL;
+    int from_mirror = 0;
+    if (mirror_url[0] != '\0' &&
+        snprintf(mirror, sizeof(mirror), "%s%s%s", mirror_url, route,
+                 release_pinned ? release_tag : "") < (int)sizeof(mirror)) {
+        root = fetch_json(mirror, 1);
+        from_mirror = root != NULL;
+        if (!root)
+            printf("%s", COLOR_YELLOW "Mirror catalog unavailable; using "
+                   "GitHub\n" COLOR_RESET);
+    }
+    if (!root)
+        root = fetch_json(url, 0);
+    if (!root)
+        exit(1);
+
+    // Releases API returns an object ({...}), not an array ([...]).
+    if (!json_is_object(root)) {
+        printf("%s", COLOR_RED
+               "Invalid JSON response format (expected release object)\n"
+               COLOR_RESET);
+        json_decref(root);
+        exit(1);
+    }
+
+    json_t *assets = json_object_get(root, "assets");
+    if (!json_is_array(assets)) {
+        printf("%s", COLOR_RED
+               "Invalid JSON: missing or malformed 'assets' array\n"
+               COLOR_RESET);
+        json_decref(root);
+        exit(1);
+    }
+
+    // Resolve "latest" to a concrete tag so downloads use the same release
+    // the catalog came from, even if a new one is published mid-run.
+    json_t *tag_obj = json_object_get(root, "tag_name");
+    if (!release_pinned &&
+        (!json_is_string(tag_obj) ||
+         !sanitize_font_name(json_string_value(tag_obj), release_tag,
+                             sizeof(release_tag)))) {
+        printf("%s", COLOR_RED
+               "Invalid JSON: missing or malformed 'tag_name'\n" COLOR_RESET);
+        json_decref(root);
+        exit(1);
     }
 
+    load_fonts_from_assets(assets);
+
+    if (from_mirror)
+        trust_mirror_catalog();
+    else if (index_merge_releases(&root, 1) < 0)
+        printf("%s", COLOR_YELLOW "Warning: Could not update release index\n"
+               COLOR_RESET);
+
     json_decref(root);
 
-    if (font_count == 0) {
+    if (catalog.count == 0) {
         printf("%s", COLOR_RED
                "No fonts found in the release assets\n" COLOR_RESET);
         exit(1);
     }
 
-    printf("%sFound %d available fonts\n%s",
-           COLOR_GREEN, font_count, COLOR_RESET);
+    printf("%sFound %d available fonts in %s\n%s",
+           COLOR_GREEN, catalog.count, release_tag, COLOR_RESET);
+}
+
+// Refresh the index from the releases list endpoint and print every known
+// tag.  Only releases missing from the index are added.  If GitHub is
+// unreachable the cached index is still listed.
+static void list_releases(void) {
+    json_t *root = fetch_json(API_BASE_URL "?per_page=100", 0);
+
+    if (root && json_is_array(root)) {
+        size_t n = json_array_size(root);
+        json_t **items = calloc(n ? n : 1, sizeof(*items));
+        if (items) {
+            for (size_t i = 0; i < n; i++)
+                items[i] = json_array_get(root, i);
+            int added = index_merge_releases(items, n);
+            if (added > 0)
+                printf("%sIndexed %d new or changed release%s\n%s",
+                       COLOR_GREEN, added, added == 1 ? "" : "s",
+                       COLOR_RESET);
+            else if (added < 0)
+                printf("%s", COLOR_YELLOW "Warning: Could not update release "
+                       "index\n" COLOR_RESET);
+            free(items);
+        }
+    } else {
+        printf("%s", COLOR_YELLOW "Showing cached releases only\n"
+               COLOR_RESET);
+    }
+    if (root)
+        json_decref(root);
+
+    if (!index_map || index_header()->release_count == 0) {
+        printf("%s", COLOR_RED "No releases in the local index\n" COLOR_RESET);
+        return;
+    }
+
+    const struct IndexRelease *rel = index_releases();
+    for (uint32_t i = 0; i < index_header()->release_count; i++)
+        printf("%-16s %u fonts\n", index_string(rel[i].tag_off),
+               rel[i].asset_count);
 }
 
 // Query terminal width, defaulting to 80 if unavailable.
@@ -561,57 +1764,27 @@ static void print_separator(void) {
     }
 }
 
-// Print font list in terminal-width-aware columns.
-static void print_fonts_in_columns(void) {
-    int term_width = get_term_width();
-    int max_len = 0;
-
-    for (int i = 0; i < font_count; i++) {
-        int len = (int)strnlen(fonts[i], MAX_FONT_NAME_LEN);
-        if (len > max_len)
-            max_len = len;
-    }
-
-    int col_width = max_len + 8; // "NNN. " prefix + padding
-    int columns   = term_width / col_width;
-    if (columns == 0)
-        columns = 1;
-
-    int rows = (font_count + columns - 1) / columns;
-
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < columns; j++) {
-            int idx = i + j * rows;
-            if (idx < font_count) {
-                char item[MAX_FONT_NAME_LEN + 20];
-                snprintf(item, sizeof(item), "%d. %.*s",
-                         idx + 1, MAX_FONT_NAME_LEN, fonts[idx]);
-                printf("%-*s", col_width, item);
-            }
-        }
-        printf("\n");
-    }
-}
-
 // Pipe font list through `less` if available, otherwise print directly.
-static void display_fonts_with_pager(void) {
+// Returns the pager's pid for the caller to wait for (see
+// prefetch_wait_for_pager()), or -1 when the list was printed directly.
+static pid_t display_fonts_with_pager(void) {
     if (!command_exists("less")) {
-        print_fonts_in_columns();
-        return;
+        print_fonts_in_columns(stdout, &catalog, get_term_width());
+        return -1;
     }
 
     int pipefd[2];
     if (pipe(pipefd) == -1) {
-        print_fonts_in_columns();
-        return;
+        print_fonts_in_columns(stdout, &catalog, get_term_width());
+        return -1;
     }
 
     pid_t pid = fork();
     if (pid == -1) {
         close(pipefd[0]);
         close(pipefd[1]);
-        print_fonts_in_columns();
-        return;
+        print_fonts_in_columns(stdout, &catalog, get_term_width());
+        return -1;
     }
 
     if (pid == 0) {
@@ -632,155 +1805,2105 @@ static void display_fonts_with_pager(void) {
         if (stdout_backup != -1) {
             dup2(pipefd[1], STDOUT_FILENO);
             close(pipefd[1]);
-            print_fonts_in_columns();
+            print_fonts_in_columns(stdout, &catalog, get_term_width());
             fflush(stdout);
             dup2(stdout_backup, STDOUT_FILENO);
             close(stdout_backup);
         } else {
             // dup failed — can't safely redirect; print directly and close pipe
             close(pipefd[1]);
-            print_fonts_in_columns();
+            print_fonts_in_columns(stdout, &catalog, get_term_width());
         }
-        wait(NULL);
     }
+    return pid;
 }
 
-// Download a font zip and extract it into fonts_path.
-// CURLOPT_FAILONERROR ensures 404 responses are treated as errors rather
-// than silently writing the HTML error page to the zip file.
-static int download_and_install_font(const char *font_name) {
-    char url[1024];
-    CURL *curl;
-    FILE *fp;
-    CURLcode res;
+// ============================================================================
+// ZIP ARCHIVE INDEX
+// ============================================================================
 
-    printf("%sDownloading and installing %s\n%s",
-           COLOR_BLUE, font_name, COLOR_RESET);
+// mmap a zip file read-only and walk its central directory.
+static long zip_list_file(const char *path, zip_entry_fn fn, void *ctx) {
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
 
-    // Sanitize font name before constructing any paths or URLs
-    char safe_name[MAX_FONT_NAME_LEN];
-    if (!sanitize_font_name(font_name, safe_name, sizeof(safe_name))) {
-        printf("%s", COLOR_RED "Error: Invalid font name\n" COLOR_RESET);
-        return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        close(fd);
+        return -1;
     }
 
-    int url_len = snprintf(url, sizeof(url),
-        "https://github.com/ryanoasis/nerd-fonts/releases/latest/download/%s.zip",
-        safe_name);
-    if (url_len < 0 || url_len >= (int)sizeof(url)) {
-        printf("%s", COLOR_RED "Error: Font name too long for URL buffer\n"
-               COLOR_RESET);
-        return 0;
-    }
+    size_t len = (size_t)st.st_size;
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
 
-    // Use realpath(path, NULL) so the system allocates a correctly-sized buffer;
-    // avoids PATH_MAX portability issues. Free after constructing zip path.
-    char *resolved_dir = realpath(unique_tmp_dir, NULL); // flawfinder: ignore
-    if (resolved_dir == NULL) {
-        printf("%s", COLOR_RED "Error: Could not resolve temp directory\n"
-               COLOR_RESET);
-        return 0;
-    }
+    long count = zip_for_each_entry(map, len, fn, ctx);
+    munmap(map, len);
+    return count;
+}
 
-    int zip_len = snprintf(current_zip_path, sizeof(current_zip_path),
-                           "%s/%s.zip", resolved_dir, safe_name);
-    free(resolved_dir);
-    if (zip_len < 0 || zip_len >= (int)sizeof(current_zip_path)) {
-        printf("%s", COLOR_RED "Error: Path too long\n" COLOR_RESET);
-        current_zip_path[0] = '\0';
+static int write_to_fd(const unsigned char *buf, size_t len, void *ctx) {
+    return write_all(*(const int *)ctx, buf, len);
+}
+
+struct Extraction {
+    const char *dest_dir;
+};
+
+// Extract one entry below dest_dir, creating its parent directories.
+// Unsafe names and directory entries are skipped.
+static int extract_entry(const struct ZipEntry *entry, void *ctx) {
+    const char *dest_dir = ((const struct Extraction *)ctx)->dest_dir;
+    char name[MAX_PATH_LEN], path[MAX_PATH_LEN];
+    if (!zip_entry_safe_name(entry, name, sizeof(name)))
         return 0;
+    int n = snprintf(path, sizeof(path), "%s/%s", dest_dir, name);
+    if (n < 0 || n >= (int)sizeof(path))
+        return -1;
+
+    char *slash = strrchr(path, '/');
+    if ((size_t)(slash - path) > strlen(dest_dir)) { // flawfinder: ignore
+        *slash = '\0';
+        int made = create_directory_secure(path);
+        *slash = '/';
+        if (made != 0)
+            return -1;
     }
 
-    curl = curl_easy_init();
-    if (!curl) {
-        printf("%sFailed to initialize curl for %s\n%s",
-               COLOR_RED, font_name, COLOR_RESET);
-        current_zip_path[0] = '\0';
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+                  0644);
+    if (fd == -1)
+        return -1;
+    int rc = zip_extract_entry(entry, write_to_fd, &fd);
+    if (close(fd) != 0)
+        rc = -1;
+    if (rc != 0)
+        secure_unlink(path);
+    return rc;
+}
+
+// Unpack an archive into dest_dir in-process (replaces `unzip -o`).
+static int extract_archive(const char *zip_path, const char *dest_dir) {
+    struct Extraction x = { dest_dir };
+    return zip_list_file(zip_path, extract_entry, &x) < 0 ? -1 : 0;
+}
+
+// extract_archive(), in a child process at idle priority with --idle, so
+// downloads and the rest of the run keep their normal priority.
+static int extract_archive_idle(const char *zip_path, const char *dest_dir) {
+    if (!idle_priority)
+        return extract_archive(zip_path, dest_dir);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == -1)
+        return extract_archive(zip_path, dest_dir);
+    if (pid == 0) {
+        // The parent cleans up on signals; the child just stops.
+        signal(SIGINT,  SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        lower_priority();
+        int rc = extract_archive(zip_path, dest_dir);
+        fflush(stdout);
+        _exit(rc == 0 ? 0 : 1);
+    }
+
+    int status;
+    while (waitpid(pid, &status, 0) == -1) {
+        if (errno != EINTR)
+            return -1;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+struct ManifestWriter {
+    FILE *fp;
+    int   flat_copies;
+};
+
+// Is there a copy of name directly in fonts_path, where earlier versions
+// unpacked every archive?
+static int has_flat_copy(const char *name) {
+    char flat[MAX_PATH_LEN];
+    struct stat st;
+    return strchr(name, '/') == NULL &&
+           snprintf(flat, sizeof(flat), "%s/%s", fonts_path, name) <
+               (int)sizeof(flat) &&
+           lstat(flat, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+static int manifest_add_entry(const struct ZipEntry *entry, void *ctx) {
+    struct ManifestWriter *w = ctx;
+    char name[MAX_PATH_LEN];
+    if (!zip_entry_safe_name(entry, name, sizeof(name)))
         return 0;
+
+    fprintf(w->fp, "%s\n", name);
+    w->flat_copies += has_flat_copy(name);
+    return 0;
+}
+
+// Record the archive's file list in family_dir so `prune` knows which files
+// belong to this family.  The manifest is replaced atomically.
+static int write_install_manifest(const char *zip_path,
+                                  const char *family_dir) {
+    char path[MAX_PATH_LEN], tmp[MAX_PATH_LEN];
+    if (snprintf(path, sizeof(path), "%s/" MANIFEST_NAME, family_dir) >=
+            (int)sizeof(path) ||
+        snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+        return -1;
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+                  0644);
+    if (fd == -1)
+        return -1;
+
+    struct ManifestWriter w = { fdopen(fd, "w"), 0 };
+    if (!w.fp) {
+        close(fd);
+        secure_unlink(tmp);
+        return -1;
+    }
+
+    long entries = zip_list_file(zip_path, manifest_add_entry, &w);
+    if (fclose(w.fp) != 0 || entries < 0 || rename(tmp, path) != 0) {
+        secure_unlink(tmp);
+        return -1;
     }
 
+    if (w.flat_copies > 0)
+        printf("%s%d older cop%s of these files remain in %s; "
+               "`nerdfonts-installer prune` removes them\n%s", COLOR_YELLOW,
+               w.flat_copies, w.flat_copies == 1 ? "y" : "ies", fonts_path,
+               COLOR_RESET);
+    return 0;
+}
+
+// Open path for writing (0600, no symlink following) and prepare an easy
+// handle for url.  With resume, an existing partial file is continued with a
+// range request; with fresh_connect the transfer gets its own connection.
+static int transfer_open(struct Transfer *t, const char *url, const char *path,
+                         int resume, int fresh_connect) {
+    struct stat st;
+    curl_off_t offset = 0;
+
+    snprintf(t->path, sizeof(t->path), "%s", path);
+    t->started = monotonic_seconds();
+    if (resume && lstat(path, &st) == 0 && S_ISREG(st.st_mode))
+        offset = (curl_off_t)st.st_size;
+
+    t->curl = curl_easy_init();
+    if (!t->curl)
+        return -1;
+
     // Create the zip file with restricted permissions and no symlink following
-    int fd = open(current_zip_path,
-                  O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, 0600);
+    int fd = open(path, O_WRONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC |
+                  (offset > 0 ? O_APPEND : O_TRUNC), 0600);
     if (fd == -1) {
         printf("%sFailed to create file %s: %s\n%s",
-               COLOR_RED, current_zip_path, strerror(errno), COLOR_RESET);
-        curl_easy_cleanup(curl);
-        current_zip_path[0] = '\0';
-        return 0;
+               COLOR_RED, path, strerror(errno), COLOR_RESET);
+        curl_easy_cleanup(t->curl);
+        t->curl = NULL;
+        return -1;
     }
 
-    fp = fdopen(fd, "wb");
-    if (!fp) {
+    t->fp = fdopen(fd, offset > 0 ? "ab" : "wb");
+    if (!t->fp) {
         printf("%sFailed to open file stream for %s\n%s",
-               COLOR_RED, current_zip_path, COLOR_RESET);
+               COLOR_RED, path, COLOR_RESET);
         close(fd);
-        curl_easy_cleanup(curl);
-        current_zip_path[0] = '\0';
+        curl_easy_cleanup(t->curl);
+        t->curl = NULL;
+        return -1;
+    }
+
+    curl_easy_setopt(t->curl, CURLOPT_URL, url);
+    curl_easy_setopt(t->curl, CURLOPT_WRITEDATA, t->fp);
+    share_connections(t->curl);
+    rate_share(t->curl, 1);
+    curl_easy_setopt(t->curl, CURLOPT_USERAGENT, "nerdfonts-installer/1.0");
+    curl_easy_setopt(t->curl, CURLOPT_FOLLOWLOCATION, 1L);
+    // FAILONERROR: treats HTTP 4xx/5xx as curl errors, preventing HTML error
+    // pages from being written to disk as if they were valid zip files.
+    curl_easy_setopt(t->curl, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(t->curl, CURLOPT_CONNECTTIMEOUT, 10L);
+    // No overall timeout: a transfer is only abandoned when it stalls, so
+    // slow-but-steady links still finish while stuck ones restart early.
+    curl_easy_setopt(t->curl, CURLOPT_LOW_SPEED_LIMIT, STALL_MIN_SPEED);
+    curl_easy_setopt(t->curl, CURLOPT_LOW_SPEED_TIME, stall_timeout);
+    if (offset > 0)
+        curl_easy_setopt(t->curl, CURLOPT_RESUME_FROM_LARGE, offset);
+    if (fresh_connect)
+        curl_easy_setopt(t->curl, CURLOPT_FRESH_CONNECT, 1L);
+    trace_watch(t->curl, &t->hops);
+    return 0;
+}
+
+static int transfer_close(struct Transfer *t) {
+    int rc = 0;
+    if (t->fp && fclose(t->fp) != 0)
+        rc = -1;
+    if (t->curl)
+        curl_easy_cleanup(t->curl);
+    t->fp   = NULL;
+    t->curl = NULL;
+    return rc;
+}
+
+// Is this transfer in the slow tail?  True unless its current speed says it
+// will finish within another hedge_after seconds.
+static int transfer_is_slow(CURL *curl) {
+    curl_off_t speed = 0, total = -1, done = 0;
+    curl_easy_getinfo(curl, CURLINFO_SPEED_DOWNLOAD_T, &speed);
+    curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &total);
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &done);
+    if (speed <= 0 || total <= 0)
+        return 1;
+    return (total - done) / speed > hedge_after;
+}
+
+// One download attempt.  With hedging enabled, a second connection races
+// the first once it has run hedge_after seconds and still looks slow; the
+// first to finish wins and the other is cancelled and discarded.
+static CURLcode download_attempt(const char *url, const char *path, int resume,
+                                 long *http_code, long *retry_after) {
+    struct Transfer primary = {0}, hedge = {0};
+    char hedge_path[MAX_PATH_LEN];
+    CURLM *multi = curl_multi_init();
+
+    *http_code = 0;
+    *retry_after = 0;
+    if (!multi)
+        return CURLE_FAILED_INIT;
+    if (transfer_open(&primary, url, path, resume, 0) != 0) {
+        curl_multi_cleanup(multi);
+        return CURLE_WRITE_ERROR;
+    }
+    curl_multi_add_handle(multi, primary.curl);
+
+    int can_hedge = hedge_after > 0 &&
+        snprintf(hedge_path, sizeof(hedge_path), "%s.hedge", path) <
+            (int)sizeof(hedge_path);
+    int primary_active = 1, hedge_active = 0, hedged = 0;
+    double started = monotonic_seconds();
+    CURLcode result = CURLE_OK;
+    struct Transfer *winner = NULL;
+
+    while (!winner && (primary_active || hedge_active)) {
+        int running;
+        if (curl_multi_perform(multi, &running) != CURLM_OK) {
+            result = CURLE_FAILED_INIT;
+            break;
+        }
+
+        CURLMsg *msg;
+        int queued;
+        while (!winner && (msg = curl_multi_info_read(multi, &queued))) {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            int is_primary = msg->easy_handle == primary.curl;
+            struct Transfer *t = is_primary ? &primary : &hedge;
+            trace_transfer(&t->hops,
+                           is_primary ? TRACE_LANE_MAIN : TRACE_LANE_HEDGE,
+                           t->started, curl_easy_strerror(msg->data.result));
+            if (msg->data.result == CURLE_OK) {
+                winner = t;
+                break;
+            }
+
+            // Report the primary's error unless the hedge outlived it.
+            if (is_primary || !primary_active) {
+                curl_off_t ra = 0;
+                result = msg->data.result;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE,
+                                  http_code);
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_RETRY_AFTER, &ra);
+                *retry_after = (long)ra;
+            }
+            if (is_primary)
+                primary_active = 0;
+            else
+                hedge_active = 0;
+        }
+
+        if (!winner && can_hedge && primary_active && !hedged &&
+            monotonic_seconds() - started >= (double)hedge_after &&
+            transfer_is_slow(primary.curl)) {
+            hedged = 1;
+            memcpy(current_hedge_path, hedge_path, sizeof(hedge_path));
+            if (transfer_open(&hedge, url, hedge_path, 0, 1) == 0) {
+                printf("%sTransfer is slow; racing a second connection\n%s",
+                       COLOR_YELLOW, COLOR_RESET);
+                curl_multi_add_handle(multi, hedge.curl);
+                hedge_active = 1;
+            }
+        }
+
+        if (!winner && (primary_active || hedge_active))
+            curl_multi_poll(multi, NULL, 0, 1000, NULL);
+    }
+
+    // Detach both transfers (cancelling the loser), then keep the winner.
+    if (primary_active && winner != &primary)
+        trace_transfer(&primary.hops, TRACE_LANE_MAIN, primary.started,
+                       "cancelled");
+    if (hedge_active && winner != &hedge)
+        trace_transfer(&hedge.hops, TRACE_LANE_HEDGE, hedge.started,
+                       "cancelled");
+    curl_multi_remove_handle(multi, primary.curl);
+    if (hedge.curl)
+        curl_multi_remove_handle(multi, hedge.curl);
+    curl_multi_cleanup(multi);
+
+    int primary_closed = transfer_close(&primary) == 0;
+    int hedge_closed   = transfer_close(&hedge) == 0;
+
+    if (winner == &primary)
+        result = primary_closed ? CURLE_OK : CURLE_WRITE_ERROR;
+    else if (winner == &hedge)
+        result = hedge_closed && rename(hedge_path, path) == 0
+               ? CURLE_OK : CURLE_WRITE_ERROR;
+    if (hedged)
+        cleanup_hedge();
+    return result;
+}
+
+// Download url into path, retrying transient failures up to retries times
+// with jittered exponential backoff (or the server's Retry-After).  A retry
+// resumes a partial file where the server supports ranges.
+static CURLcode download_to_file(const char *url, const char *path,
+                                 int retries) {
+    CURLcode res;
+    int resume = 0;
+
+    for (int attempt = 0;; attempt++) {
+        long http_code, retry_after;
+        res = download_attempt(url, path, resume, &http_code, &retry_after);
+        if (res == CURLE_OK || attempt >= retries ||
+            !should_retry(res, http_code, retry_after))
+            break;
+
+        // The server ignored our range request: start over next time.
+        resume = res != CURLE_RANGE_ERROR;
+
+        long delay = backoff_delay_ms(attempt, retry_after);
+        if (delay < 0)
+            break;
+        if (res == CURLE_HTTP_RETURNED_ERROR)
+            printf("%sDownload failed (HTTP %ld); retrying in %.1fs\n%s",
+                   COLOR_YELLOW, http_code, (double)delay / 1000.0,
+                   COLOR_RESET);
+        else
+            printf("%sDownload failed (%s); retrying in %.1fs\n%s",
+                   COLOR_YELLOW, curl_easy_strerror(res),
+                   (double)delay / 1000.0, COLOR_RESET);
+        double slept = monotonic_seconds();
+        sleep_ms(delay);
+        trace_span("backoff", "retry", slept, NULL);
+    }
+    return res;
+}
+
+// ============================================================================
+// DELTA UPDATES
+// ============================================================================
+//
+// With --delta an archive is rebuilt from the copy of an earlier release in
+// the cache.  The mirror publishes a block index of the new archive; blocks
+// found in the old one are copied locally and only the rest is fetched with
+// range requests.  The result must match the index's SHA-256, itself checked
+// against the catalog digest, or it is discarded for a full download.
+
+// The newest cached copy of name from a release other than tag.
+static int find_delta_base(const char *tag, const char *name, char *out,
+                           size_t out_size, char *base_tag,
+                           size_t base_tag_size) {
+    char dir[MAX_PATH_LEN], candidate[MAX_PATH_LEN];
+    time_t newest = 0;
+    struct dirent *ent;
+    struct stat st;
+
+    if (snprintf(dir, sizeof(dir), "%s/archives", cache_path) >=
+        (int)sizeof(dir))
+        return 0;
+    DIR *archives = opendir(dir);
+    if (!archives)
         return 0;
+    while ((ent = readdir(archives)) != NULL) {
+        if (ent->d_name[0] == '.' || strcmp(ent->d_name, tag) == 0 ||
+            strlen(ent->d_name) >= base_tag_size || // flawfinder: ignore
+            snprintf(candidate, sizeof(candidate), "%s/%s/%s.zip", dir,
+                     ent->d_name, name) >= (int)sizeof(candidate) ||
+            lstat(candidate, &st) != 0 || !S_ISREG(st.st_mode) ||
+            st.st_mtime <= newest)
+            continue;
+        newest = st.st_mtime;
+        snprintf(out, out_size, "%s", candidate);
+        memcpy(base_tag, ent->d_name, strlen(ent->d_name) + 1); // flawfinder: ignore
     }
+    closedir(archives);
+    return newest > 0;
+}
+
+// One GET into memory, no retries: a mirror that cannot answer is skipped.
+// range ("first-last", or NULL for the whole file) may be ignored by the
+// server, so callers check what they got.
+static CURLcode fetch_to_memory(const char *url, const char *range,
+                                struct HTTPResponse *out) {
+    CURL *curl = curl_easy_init();
+    if (!curl)
+        return CURLE_FAILED_INIT;
 
     curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, fp);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "nerdfonts-installer/1.0");
+    curl_easy_setopt(curl, CURLOPT_RANGE, range);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    // FAILONERROR: treats HTTP 4xx/5xx as curl errors, preventing HTML error
-    // pages from being written to disk as if they were valid zip files.
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)out);
+    share_connections(curl);
+    rate_share(curl, 1);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "nerdfonts-installer/1.0");
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, STALL_MIN_SPEED);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, stall_timeout);
+
+    struct TraceHops hops;
+    trace_watch(curl, &hops);
+    double started = monotonic_seconds();
+    CURLcode res = curl_easy_perform(curl);
+    trace_transfer(&hops, TRACE_LANE_MAIN, started, curl_easy_strerror(res));
+    curl_easy_cleanup(curl);
+    return res;
+}
+
+static int pwrite_all(int fd, const unsigned char *buf, size_t len,
+                      uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, (off_t)offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        buf    += n;
+        len    -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 0;
+}
+
+// Where the body of one range request goes.  Anything past the requested
+// range (a server ignoring Range) aborts the transfer.
+struct RangeSink {
+    int      fd;
+    uint64_t offset;
+    uint64_t remaining;
+};
+
+static size_t range_write_callback(char *ptr, size_t size, size_t nmemb,
+                                   void *userp) {
+    struct RangeSink *sink = userp;
+    size_t len = size * nmemb;
+    if (len > sink->remaining ||
+        pwrite_all(sink->fd, (const unsigned char *)ptr, len,
+                   sink->offset) != 0)
+        return 0;
+    sink->offset    += len;
+    sink->remaining -= len;
+    return len;
+}
+
+// Fetch bytes [start, end) of url into fd at the same offset.
+static int fetch_range(CURL *curl, const char *url, int fd, uint64_t start,
+                       uint64_t end) {
+    char range[64];
+    struct RangeSink sink = { fd, start, end - start };
+    snprintf(range, sizeof(range), "%llu-%llu", (unsigned long long)start,
+             (unsigned long long)end - 1);
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_RANGE, range);
+    share_connections(curl);
+    rate_share(curl, 1);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, range_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&sink);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "nerdfonts-installer/1.0");
     curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
     curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 300L); // 5 min for large fonts
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, STALL_MIN_SPEED);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, stall_timeout);
+
+    struct TraceHops hops;
+    trace_watch(curl, &hops);
+    double started = monotonic_seconds();
+    CURLcode res = curl_easy_perform(curl);
+    trace_transfer(&hops, TRACE_LANE_MAIN, started, curl_easy_strerror(res));
+
+    long http_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    return res == CURLE_OK && http_code == 206 && sink.remaining == 0
+         ? 0 : -1;
+}
+
+// Copy the matched blocks from old into fd, then fetch the others from url
+// in runs, bridging gaps of up to DELTA_MERGE_GAP matched blocks.  Returns
+// the number of bytes fetched, or -1.
+static long long delta_assemble(const struct BlockIndex *index,
+                                const uint64_t *matches,
+                                const unsigned char *old, int fd,
+                                const char *url) {
+    uint64_t bs = index->block_size;
+    for (size_t i = 0; i < index->count; i++) {
+        uint64_t start = i * bs;
+        uint64_t len = index->file_size - start < bs
+                     ? index->file_size - start : bs;
+        if (matches[i] != DELTA_NO_MATCH &&
+            pwrite_all(fd, old + matches[i], (size_t)len, start) != 0)
+            return -1;
+    }
+
+    CURL *curl = curl_easy_init();
+    if (!curl)
+        return -1;
+    long long fetched = 0;
+    for (size_t i = 0; i < index->count;) {
+        if (matches[i] != DELTA_NO_MATCH) {
+            i++;
+            continue;
+        }
+        size_t run_end = i + 1;
+        for (size_t k = run_end;
+             k < index->count && k - run_end <= DELTA_MERGE_GAP; k++) {
+            if (matches[k] == DELTA_NO_MATCH)
+                run_end = k + 1;
+        }
+
+        uint64_t start = i * bs;
+        uint64_t end = run_end * bs < index->file_size
+                     ? run_end * bs : index->file_size;
+        if (fetch_range(curl, url, fd, start, end) != 0) {
+            fetched = -1;
+            break;
+        }
+        fetched += (long long)(end - start);
+        i = run_end;
+    }
+    curl_easy_cleanup(curl);
+    return fetched;
+}
+
+// Try to build <tag>/<name>.zip at path from an older cached copy.
+// Returns 1 if path now holds the verified archive; 0 means download it
+// whole (path may hold garbage and is overwritten by the caller).  Without
+// a catalog digest the only check would be the mirror's own index, so the
+// archive is downloaded whole instead.  The index must also agree with the
+// catalog size, so a bad mirror cannot size the output file or the range
+// plan before the final digest check.
+static int delta_fetch(const char *tag, const char *name,
+                       const unsigned char *digest, uint64_t size,
+                       const char *path) {
+    char base[MAX_PATH_LEN], base_tag[MAX_TAG_LEN];
+    char index_url[MAX_PATH_LEN], url[MAX_PATH_LEN];
+    struct HTTPResponse response = {0};
+    struct BlockIndex index;
+    struct stat st;
+
+    if (!digest || size == 0 ||
+        !find_delta_base(tag, name, base, sizeof(base), base_tag,
+                         sizeof(base_tag)) ||
+        snprintf(url, sizeof(url), "%s/download/%s/%s.zip", mirror_url, tag,
+                 name) >= (int)sizeof(url) ||
+        snprintf(index_url, sizeof(index_url), "%s.blocks", url) >=
+            (int)sizeof(index_url))
+        return 0;
+
+    if (fetch_to_memory(index_url, NULL, &response) != CURLE_OK ||
+        !delta_parse_index((const unsigned char *)response.memory,
+                           response.size, &index) ||
+        index.file_size != size ||
+        memcmp(digest, index.sha256, SHA256_LEN) != 0) {
+        printf("%sMirror has no usable block index for %s\n%s",
+               COLOR_YELLOW, name, COLOR_RESET);
+        free(response.memory);
+        return 0;
+    }
+
+    int base_fd = open(base, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    void *old = MAP_FAILED;
+    size_t old_len = 0;
+    if (base_fd != -1 && fstat(base_fd, &st) == 0 && st.st_size > 0) {
+        old_len = (size_t)st.st_size;
+        old = mmap(NULL, old_len, PROT_READ, MAP_PRIVATE, base_fd, 0);
+    }
+    if (base_fd != -1)
+        close(base_fd);
+
+    uint64_t *matches = calloc(index.count ? index.count : 1,
+                               sizeof(*matches));
+    long matched = -1;
+    long long fetched = -1;
+    if (old != MAP_FAILED && matches)
+        matched = delta_match_blocks(&index, old, old_len, matches);
+
+    if (matched >= 0) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW |
+                      O_CLOEXEC, 0600);
+        if (fd != -1) {
+            if (ftruncate(fd, (off_t)index.file_size) == 0)
+                fetched = delta_assemble(&index, matches, old, fd, url);
+            if (close(fd) != 0)
+                fetched = -1;
+        }
+    }
+    if (old != MAP_FAILED)
+        munmap(old, old_len);
+    free(matches);
+    free(response.memory);
+
+    if (fetched < 0 || !file_matches_digest(path, index.sha256)) {
+        printf("%sDelta update of %s failed; downloading it whole\n%s",
+               COLOR_YELLOW, name, COLOR_RESET);
+        return 0;
+    }
+
+    char fetched_str[32], total_str[32];
+    format_size((uint64_t)fetched, fetched_str, sizeof(fetched_str));
+    format_size(index.file_size, total_str, sizeof(total_str));
+    printf("%sDelta from %s: reused %ld of %zu blocks, fetched %s of %s\n%s",
+           COLOR_BLUE, base_tag, matched, index.count, fetched_str, total_str,
+           COLOR_RESET);
+    return 1;
+}
+
+// Fetch <tag>/<name>.zip into path: from the mirror first when one is
+// configured (as a delta with --delta), then from GitHub.  Each copy is
+// checked against the expected digest (when the catalog has one) before it
+// is accepted.  The mirror is only used when there is a digest to hold it
+// to.
+static int fetch_archive(const char *tag, const char *name,
+                         const unsigned char *digest, uint64_t size,
+                         const char *path) {
+    char url[MAX_PATH_LEN];
+
+    if (mirror_url[0] != '\0' && delta_updates &&
+        delta_fetch(tag, name, digest, size, path))
+        return 1;
+
+    if (mirror_url[0] != '\0' && digest &&
+        snprintf(url, sizeof(url), "%s/download/%s/%s.zip", mirror_url, tag,
+                 name) < (int)sizeof(url)) {
+        if (download_to_file(url, path, 0) != CURLE_OK)
+            printf("%sMirror has no copy of %s; using GitHub\n%s",
+                   COLOR_YELLOW, name, COLOR_RESET);
+        else if (!file_matches_digest(path, digest))
+            printf("%sMirror copy of %s failed digest check; using GitHub\n%s",
+                   COLOR_YELLOW, name, COLOR_RESET);
+        else
+            return 1;
+    }
+
+    int url_len = snprintf(url, sizeof(url), DOWNLOAD_BASE_URL "/%s/%s.zip",
+                           tag, name);
+    if (url_len < 0 || url_len >= (int)sizeof(url)) {
+        printf("%s", COLOR_RED "Error: Font name too long for URL buffer\n"
+               COLOR_RESET);
+        return 0;
+    }
+
+    CURLcode res = download_to_file(url, path, max_retries);
+    if (res != CURLE_OK) {
+        printf("%sFailed to download %s: %s\n%s",
+               COLOR_RED, name, curl_easy_strerror(res), COLOR_RESET);
+        return 0;
+    }
+    if (!file_matches_digest(path, digest)) {
+        printf("%sDigest mismatch for %s; download discarded\n%s",
+               COLOR_RED, name, COLOR_RESET);
+        return 0;
+    }
+    return 1;
+}
+
+// <cache_path>/archives/<tag>/<name>.zip
+static int archive_cache_path(const char *tag, const char *name, char *out,
+                              size_t out_size) {
+    int n = snprintf(out, out_size, "%s/archives/%s/%s.zip", cache_path, tag,
+                     name);
+    return n > 0 && (size_t)n < out_size;
+}
+
+// A cached archive is trusted if it matches the catalog digest, or failing
+// that, the catalog size.  With neither it is re-downloaded.
+static int cached_archive_valid(const char *path, const unsigned char *digest,
+                                uint64_t size) {
+    struct stat st;
+    if (lstat(path, &st) != 0 || !S_ISREG(st.st_mode))
+        return 0;
+    if (digest)
+        return file_matches_digest(path, digest);
+    return size > 0 && (uint64_t)st.st_size == size;
+}
+
+// Move src to dst, copying when they live on different filesystems.
+static int move_file(const char *src, const char *dst) {
+    if (rename(src, dst) == 0)
+        return 0;
+    if (errno != EXDEV)
+        return -1;
+
+    int in = open(src, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (in == -1)
+        return -1;
+    int out = open(dst, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+                   0644);
+    if (out == -1) {
+        close(in);
+        return -1;
+    }
+
+    unsigned char buf[65536];
+    ssize_t n;
+    int ok = 1;
+    while (ok && (n = read(in, buf, sizeof(buf))) != 0) { // flawfinder: ignore
+        if (n < 0)
+            ok = errno == EINTR;
+        else
+            ok = write_all(out, buf, (size_t)n) == 0;
+    }
+    close(in);
+    if (close(out) != 0 || !ok) {
+        secure_unlink(dst);
+        return -1;
+    }
+    return secure_unlink(src);
+}
+
+// Read <cache_path>/history, one "<count> <family>" line per family
+// installed on this host, most installed first.  Returns the entry count.
+static int read_install_history(char names[][MAX_FONT_NAME_LEN], long *counts,
+                                int max) {
+    char path[MAX_PATH_LEN], line[128];
+    int len = snprintf(path, sizeof(path), "%s/" HISTORY_FILE_NAME,
+                       cache_path);
+    if (len < 0 || len >= (int)sizeof(path))
+        return 0;
+
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return 0;
+
+    int n = 0;
+    while (n < max && fgets(line, sizeof(line), fp)) {
+        char name[MAX_FONT_NAME_LEN];
+        long count;
+        if (sscanf(line, "%ld %49s", &count, name) == 2 && count > 0 && // flawfinder: ignore
+            sanitize_font_name(name, names[n], MAX_FONT_NAME_LEN))
+            counts[n++] = count;
+    }
+    fclose(fp);
+    return n;
+}
+
+// Count one more install of a catalog font.  The file is replaced
+// atomically, so a concurrent reader sees the old or the new history.
+static void record_install_history(int font_idx) {
+    char names[MAX_FONTS][MAX_FONT_NAME_LEN];
+    long counts[MAX_FONTS];
+    int n = read_install_history(names, counts, MAX_FONTS);
+
+    const char *font = catalog.names[font_idx];
+    int j = 0;
+    while (j < n && strcmp(names[j], font) != 0)
+        j++;
+    if (j == n) {
+        if (n == MAX_FONTS ||
+            !sanitize_font_name(font, names[n], MAX_FONT_NAME_LEN))
+            return;
+        counts[n++] = 0;
+    }
+
+    // Move the entry up past those it now outnumbers; ties keep their order.
+    char name[MAX_FONT_NAME_LEN];
+    long count = counts[j] + 1;
+    memcpy(name, names[j], sizeof(name));
+    for (; j > 0 && counts[j - 1] < count; j--) {
+        memcpy(names[j], names[j - 1], sizeof(name));
+        counts[j] = counts[j - 1];
+    }
+    memcpy(names[j], name, sizeof(name));
+    counts[j] = count;
+
+    char path[MAX_PATH_LEN], tmp[MAX_PATH_LEN];
+    int len = snprintf(path, sizeof(path), "%s/" HISTORY_FILE_NAME,
+                       cache_path);
+    if (len < 0 || len >= (int)sizeof(path) ||
+        snprintf(tmp, sizeof(tmp), "%s.%ld", path, (long)getpid()) >=
+            (int)sizeof(tmp))
+        return;
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+                  0644);
+    if (fd == -1)
+        return;
+    FILE *fp = fdopen(fd, "w");
+    if (!fp) {
+        close(fd);
+        secure_unlink(tmp);
+        return;
+    }
+    for (int i = 0; i < n; i++)
+        fprintf(fp, "%ld %s\n", counts[i], names[i]);
+    if (fclose(fp) != 0 || rename(tmp, path) != 0)
+        secure_unlink(tmp);
+}
+
+// Install one font: reuse a verified archive from the cache when there is
+// one, otherwise download it (mirror first, then GitHub).  The archive is
+// extracted into its own directory under fonts_path and its file list is
+// recorded there for `prune`.  With --keep-archives the download is moved
+// into the cache instead of being deleted, which is what `serve` shares.
+static int install_font(int font_idx, int *from_cache) {
+    const char *font_name = catalog.names[font_idx];
+    const unsigned char *digest =
+        catalog.has_digest[font_idx] ? catalog.digests[font_idx] : NULL;
+
+    printf("%sDownloading and installing %s\n%s",
+           COLOR_BLUE, font_name, COLOR_RESET);
+
+    // Sanitize font name before constructing any paths or URLs
+    char safe_name[MAX_FONT_NAME_LEN];
+    if (!sanitize_font_name(font_name, safe_name, sizeof(safe_name))) {
+        printf("%s", COLOR_RED "Error: Invalid font name\n" COLOR_RESET);
+        return 0;
+    }
+
+    char family_dir[MAX_PATH_LEN], cached[MAX_PATH_LEN];
+    int dir_len = snprintf(family_dir, sizeof(family_dir), "%s/%s",
+                           fonts_path, safe_name);
+    if (dir_len < 0 || dir_len >= (int)sizeof(family_dir) ||
+        !archive_cache_path(release_tag, safe_name, cached, sizeof(cached))) {
+        printf("%s", COLOR_RED "Error: Path too long\n" COLOR_RESET);
+        return 0;
+    }
+
+    const char *zip_path = cached;
+
+    if (cached_archive_valid(cached, digest, catalog.sizes[font_idx])) {
+        printf("%sUsing cached archive for %s\n%s",
+               COLOR_BLUE, font_name, COLOR_RESET);
+        *from_cache = 1;
+    } else {
+        // Use realpath(path, NULL) so the system allocates a correctly-sized buffer;
+        // avoids PATH_MAX portability issues. Free after constructing zip path.
+        char *resolved_dir = realpath(unique_tmp_dir, NULL); // flawfinder: ignore
+        if (resolved_dir == NULL) {
+            printf("%s", COLOR_RED "Error: Could not resolve temp directory\n"
+                   COLOR_RESET);
+            return 0;
+        }
+
+        int zip_len = snprintf(current_zip_path, sizeof(current_zip_path),
+                               "%s/%s.zip", resolved_dir, safe_name);
+        free(resolved_dir);
+        if (zip_len < 0 || zip_len >= (int)sizeof(current_zip_path)) {
+            printf("%s", COLOR_RED "Error: Path too long\n" COLOR_RESET);
+            current_zip_path[0] = '\0';
+            return 0;
+        }
+
+        double fetch_started = monotonic_seconds();
+        int fetched = fetch_archive(release_tag, safe_name, digest,
+                                    catalog.sizes[font_idx], current_zip_path);
+        trace_span("download", "phase", fetch_started, NULL);
+        if (!fetched) {
+            cleanup_zip();
+            return 0;
+        }
+
+        zip_path = current_zip_path;
+        if (keep_archives) {
+            char cache_dir[MAX_PATH_LEN];
+            snprintf(cache_dir, sizeof(cache_dir), "%s", cached);
+            *strrchr(cache_dir, '/') = '\0';
+            double store_started = monotonic_seconds();
+            if (create_directory_secure(cache_dir) == 0 &&
+                move_file(current_zip_path, cached) == 0) {
+                current_zip_path[0] = '\0';
+                zip_path = cached;
+            }
+            trace_span("cache store", "disk", store_started, NULL);
+        }
+    }
+
+    double extract_started = monotonic_seconds();
+    int extracted = create_directory_secure(family_dir) == 0 &&
+                    extract_archive_idle(zip_path, family_dir) == 0;
+    trace_span("extract", "disk", extract_started, NULL);
+    if (!extracted) {
+        printf("%sFailed to extract %s\n%s",
+               COLOR_RED, font_name, COLOR_RESET);
+        cleanup_zip();
+        return 0;
+    }
+
+    // Non-fatal: the fonts are installed, prune just won't know about them.
+    double manifest_started = monotonic_seconds();
+    if (write_install_manifest(zip_path, family_dir) != 0)
+        printf("%sWarning: Could not record file list for %s\n%s",
+               COLOR_YELLOW, font_name, COLOR_RESET);
+    trace_span("manifest", "disk", manifest_started, NULL);
+
+    cleanup_zip();
+    printf("%s✓ %s installed successfully\n%s",
+           COLOR_GREEN, font_name, COLOR_RESET);
+    return 1;
+}
+
+// install_font() wrapped in a per-font trace span.  Successful installs
+// feed the history behind --prefetch auto.
+static int download_and_install_font(int font_idx) {
+    double started = monotonic_seconds();
+    int from_cache = 0;
+    int ok = install_font(font_idx, &from_cache);
+    if (ok)
+        record_install_history(font_idx);
+
+    json_t *args = NULL;
+    if (trace_fp) {
+        args = json_object();
+        json_object_set_new(args, "size",
+                            json_integer((json_int_t)catalog.sizes[font_idx]));
+        json_object_set_new(args, "cached", json_integer(from_cache));
+        json_object_set_new(args, "installed", json_integer(ok));
+    }
+    trace_span(catalog.names[font_idx], "font", started, args);
+    return ok;
+}
+
+// Rebuild the font cache via fc-cache.  With ndirs > 0 only those
+// directories are rescanned; otherwise fc-cache walks its whole config.
+static void update_font_cache(const char *const *dirs, size_t ndirs) {
+    const char **args = calloc(ndirs + 3, sizeof(*args));
+    if (!args) {
+        printf("%s", COLOR_YELLOW "Warning: Failed to allocate font cache "
+               "arguments\n" COLOR_RESET);
+        return;
+    }
+    args[0] = "fc-cache";
+    args[1] = "-f";
+    for (size_t i = 0; i < ndirs; i++)
+        args[i + 2] = dirs[i];
+
+    double started = monotonic_seconds();
+    pid_t pid = fork();
+    if (pid == -1) {
+        printf("%s", COLOR_YELLOW "Warning: Failed to fork for font cache "
+               "update\n" COLOR_RESET);
+        free(args);
+        return;
+    }
+
+    if (pid == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull != -1) {
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+            close(devnull);
+        }
+        if (idle_priority)
+            lower_priority();
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-qual"
+        execvp("fc-cache", (char *const *)args); // flawfinder: ignore
+#pragma GCC diagnostic pop
+        _exit(127);
+    }
+
+    free(args);
+    int status;
+    waitpid(pid, &status, 0);
+    trace_span("fc-cache", "phase", started, NULL);
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        printf("%s", COLOR_GREEN "✓ Font cache updated\n" COLOR_RESET);
+    else
+        printf("%s", COLOR_YELLOW "Warning: Font cache update failed, "
+               "but fonts were installed\n" COLOR_RESET);
+}
+
+// ============================================================================
+// DISK SPACE
+// ============================================================================
+
+// The filesystem a directory lives on.  known is 0 when it cannot be
+// examined, in which case no space check is made for it.
+struct FsInfo {
+    int      known;
+    int      tmpfs;
+    dev_t    dev;
+    uint64_t avail;   // bytes an unprivileged user may still write
+};
+
+static struct FsInfo fs_info(const char *path) {
+    struct FsInfo info = {0};
+    struct stat st;
+    struct statvfs vfs;
+    struct statfs sfs;
+
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode) ||
+        statvfs(path, &vfs) != 0)
+        return info;
+    info.known = 1;
+    info.dev   = st.st_dev;
+    info.avail = (uint64_t)vfs.f_bavail * (uint64_t)vfs.f_frsize;
+    info.tmpfs = statfs(path, &sfs) == 0 && sfs.f_type == TMPFS_MAGIC;
+    return info;
+}
+
+// Total need on location i's filesystem, counting every location that
+// shares it.
+static uint64_t space_on_device(const struct FsInfo *fs, const uint64_t *need,
+                                int n, int i) {
+    uint64_t total = 0;
+    for (int j = 0; j < n; j++) {
+        if (fs[j].known && fs[j].dev == fs[i].dev)
+            total += need[j];
+    }
+    return total;
+}
+
+static int space_fits(const struct FsInfo *fs, const uint64_t *need, int n) {
+    for (int i = 0; i < n; i++) {
+        if (fs[i].known && need[i] > 0 &&
+            space_on_device(fs, need, n, i) + DISK_HEADROOM > fs[i].avail)
+            return 0;
+    }
+    return 1;
+}
+
+// Check that the selected fonts will fit before downloading any of them,
+// and create the temp dir where they fit best.  Archive sizes come from
+// the catalog; extracted sizes are estimated with EXTRACT_RATIO.  Archives
+// are downloaded one at a time, so the temp dir only ever holds the
+// largest of them, while --keep-archives stores all of them in the cache.
+//
+// An explicit $TMPDIR is always used.  Otherwise the temp dir goes, in
+// order of preference, where an archive can be stored with a rename (the
+// cache, with --keep-archives), on a tmpfs, or anywhere else it fits.
+// Returns 0, after explaining why, if the install cannot fit.
+static int preflight_disk_space(const int *selected, int num_selected) {
+    uint64_t download = 0, largest = 0, installed = 0;
+
+    for (int i = 0; i < num_selected; i++) {
+        uint64_t size = catalog.sizes[selected[i]];
+        char safe_name[MAX_FONT_NAME_LEN], cached[MAX_PATH_LEN];
+        struct stat st;
+
+        installed += size * EXTRACT_RATIO;
+        if (size > 0 &&
+            sanitize_font_name(catalog.names[selected[i]], safe_name,
+                               sizeof(safe_name)) &&
+            archive_cache_path(release_tag, safe_name, cached,
+                               sizeof(cached)) &&
+            lstat(cached, &st) == 0 && S_ISREG(st.st_mode) &&
+            (uint64_t)st.st_size == size)
+            continue; // cached; nothing to download
+        download += size;
+        if (size > largest)
+            largest = size;
+    }
+
+    const char *candidates[3];
+    int ncandidates = 0;
+    const char *env_tmp = getenv("TMPDIR"); // flawfinder: ignore
+    const char *runtime = getenv("XDG_RUNTIME_DIR"); // flawfinder: ignore
+    if (env_tmp && env_tmp[0] != '\0') {
+        candidates[ncandidates++] = env_tmp;
+    } else {
+        candidates[ncandidates++] = "/tmp";
+        if (runtime && runtime[0] == '/')
+            candidates[ncandidates++] = runtime;
+        candidates[ncandidates++] = cache_path;
+    }
+
+    // Locations: 0 fonts, 1 cache, 2 temp.
+    const char *labels[3] = { "fonts", "cache", "temp" };
+    const char *paths[3]  = { fonts_path, cache_path, NULL };
+    struct FsInfo fs[3]   = { fs_info(fonts_path), fs_info(cache_path) };
+    uint64_t need[3]      = { installed, keep_archives ? download : 0, 0 };
+
+    int best = -1, best_rank = 3;
+    for (int c = 0; c < ncandidates; c++) {
+        struct FsInfo info = fs_info(candidates[c]);
+        if (!info.known || access(candidates[c], W_OK) != 0) // flawfinder: ignore
+            continue;
+        int rename_to_cache = keep_archives && fs[1].known &&
+                              info.dev == fs[1].dev;
+        int rank = rename_to_cache ? 0 : info.tmpfs ? 1 : 2;
+        if (paths[2] == NULL) { // report against the first usable one
+            paths[2] = candidates[c];
+            fs[2]    = info;
+            need[2]  = rename_to_cache ? 0 : largest;
+        }
+        uint64_t trial_need[3] = { need[0], need[1],
+                                   rename_to_cache ? 0 : largest };
+        struct FsInfo trial_fs[3] = { fs[0], fs[1], info };
+        if (rank < best_rank && space_fits(trial_fs, trial_need, 3)) {
+            best      = c;
+            best_rank = rank;
+        }
+    }
+
+    char download_str[32], installed_str[32];
+    format_size(download, download_str, sizeof(download_str));
+    format_size(installed, installed_str, sizeof(installed_str));
+
+    if (paths[2] == NULL) {
+        printf("%s", COLOR_RED "Error: No writable temp directory; set "
+               "TMPDIR\n" COLOR_RESET);
+        return 0;
+    }
+
+    if (best == -1) {
+        printf("%sError: Not enough disk space for this install\n"
+               "  Estimated %s to download, ~%s once installed\n%s",
+               COLOR_RED, download_str, installed_str, COLOR_RESET);
+        for (int i = 0; i < 3; i++) {
+            char need_str[32], reserve_str[32], avail_str[32];
+            uint64_t total = space_on_device(fs, need, 3, i);
+            if (!fs[i].known || need[i] == 0 ||
+                total + DISK_HEADROOM <= fs[i].avail)
+                continue;
+            format_size(total, need_str, sizeof(need_str));
+            format_size(DISK_HEADROOM, reserve_str, sizeof(reserve_str));
+            format_size(fs[i].avail, avail_str, sizeof(avail_str));
+            printf("  %-5s %s: needs %s plus %s reserve, %s free\n",
+                   labels[i], paths[i], need_str, reserve_str, avail_str);
+        }
+        printf("%s", COLOR_YELLOW "Free some space, point TMPDIR elsewhere, "
+               "or select fewer fonts.\n" COLOR_RESET);
+        return 0;
+    }
+
+    create_temp_dir(candidates[best]);
+    printf("%sEstimated %s to download, ~%s once installed (temp: %s%s)\n%s",
+           COLOR_BLUE, download_str, installed_str, candidates[best],
+           best_rank == 1 ? ", tmpfs" : "", COLOR_RESET);
+    return 1;
+}
+
+// ============================================================================
+// PREFETCH
+// ============================================================================
+
+// The font prompt waits on the user with the network idle.  While it is
+// up, a HEAD request for one archive resolves, connects and negotiates TLS
+// with the download host and the asset host it redirects to; curl_share
+// then hands those connections to the real downloads.  With --prefetch the
+// families the user is likely to pick are also downloaded into the archive
+// cache, where install_font() finds them.  Everything runs on one multi
+// handle polled together with the terminal, so no threads are involved.
+
+// Catalog index of a family, ignoring case, or -1.
+static int catalog_find(const char *name) {
+    for (int i = 0; i < catalog.count; i++) {
+        if (strcasecmp(catalog.names[i], name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+// The families to prefetch, at most PREFETCH_MAX: the --prefetch list, or
+// for "auto" the PREFETCH_AUTO most installed ones.  Unknown names are
+// skipped.
+static int prefetch_candidates(int out[PREFETCH_MAX]) {
+    int n = 0;
+
+    if (strcasecmp(prefetch_list, "auto") == 0) {
+        char names[PREFETCH_AUTO][MAX_FONT_NAME_LEN];
+        long counts[PREFETCH_AUTO];
+        int h = read_install_history(names, counts, PREFETCH_AUTO);
+        for (int i = 0; i < h; i++) {
+            int idx = catalog_find(names[i]);
+            if (idx >= 0)
+                out[n++] = idx;
+        }
+        return n;
+    }
+
+    char list[1024];
+    char *save = NULL;
+    snprintf(list, sizeof(list), "%s", prefetch_list); // flawfinder: ignore
+    for (char *name = strtok_r(list, ",", &save); name;
+         name = strtok_r(NULL, ",", &save)) {
+        int idx = catalog_find(name);
+        int seen = 0;
+        for (int i = 0; i < n; i++)
+            seen |= out[i] == idx;
+        if (idx < 0 || seen)
+            continue;
+        out[n++] = idx;
+        if (n == PREFETCH_MAX)
+            break;
+    }
+    return n;
+}
+
+// Start one prefetch of a catalog font into its cache slot.  Fonts already
+// cached, or that --delta would rebuild from an older copy, are left alone.
+// Like fetch_archive(), only fonts with a digest come from the mirror.
+static void prefetch_font(int font_idx, struct FsInfo *cache_fs) {
+    char safe_name[MAX_FONT_NAME_LEN], cached[MAX_PATH_LEN];
+    char part[MAX_PATH_LEN], url[MAX_PATH_LEN], base[MAX_PATH_LEN];
+    char base_tag[MAX_TAG_LEN];
+    uint64_t size = catalog.sizes[font_idx];
+    int use_mirror = mirror_url[0] != '\0' && catalog.has_digest[font_idx];
+    struct stat st;
+
+    if (!sanitize_font_name(catalog.names[font_idx], safe_name,
+                            sizeof(safe_name)) ||
+        !archive_cache_path(release_tag, safe_name, cached, sizeof(cached)) ||
+        snprintf(part, sizeof(part), "%s.part", cached) >= (int)sizeof(part))
+        return;
+    if (lstat(cached, &st) == 0)
+        return;
+    if (use_mirror && delta_updates &&
+        find_delta_base(release_tag, safe_name, base, sizeof(base), base_tag,
+                        sizeof(base_tag)))
+        return;
+    if (cache_fs->known && size + DISK_HEADROOM > cache_fs->avail)
+        return;
+
+    int url_len = use_mirror
+        ? snprintf(url, sizeof(url), "%s/download/%s/%s.zip", mirror_url,
+                   release_tag, safe_name)
+        : snprintf(url, sizeof(url), DOWNLOAD_BASE_URL "/%s/%s.zip",
+                   release_tag, safe_name);
+    if (url_len < 0 || url_len >= (int)sizeof(url))
+        return;
+
+    char cache_dir[MAX_PATH_LEN];
+    snprintf(cache_dir, sizeof(cache_dir), "%s", cached);
+    *strrchr(cache_dir, '/') = '\0';
+    if (create_directory_secure(cache_dir) != 0)
+        return;
+
+    struct Prefetch *p = &prefetches[prefetch_count];
+    if (transfer_open(&p->t, url, part, 0, 0) != 0)
+        return;
+    p->font_idx = font_idx;
+    p->state    = PREFETCH_RUNNING;
+    snprintf(p->cached, sizeof(p->cached), "%s", cached);
+    memcpy(prefetch_parts[prefetch_count], part, sizeof(part));
+    curl_multi_add_handle(prefetch_multi, p->t.curl);
+    prefetch_count++;
+    if (cache_fs->known)
+        cache_fs->avail -= size;
+}
+
+// Split --max-rate between the prefetches still running.
+static void prefetch_share_rate(void) {
+    int running = 0;
+    for (int i = 0; i < prefetch_count; i++)
+        running += prefetches[i].state == PREFETCH_RUNNING;
+    for (int i = 0; i < prefetch_count; i++) {
+        if (prefetches[i].state == PREFETCH_RUNNING)
+            rate_share(prefetches[i].t.curl, running);
+    }
+}
+
+// Warm up connections and start any prefetches.  Called before the font
+// list is shown, so the transfers get the whole prompt.
+static void prefetch_start(void) {
+    char url[MAX_PATH_LEN], safe_name[MAX_FONT_NAME_LEN];
+
+    if (!curl_share || catalog.count == 0 ||
+        !(prefetch_multi = curl_multi_init()))
+        return;
+
+    // The mirror fills archive misses from GitHub, even for a HEAD, so it
+    // gets a catalog request instead.
+    int url_len = -1;
+    if (mirror_url[0] != '\0')
+        url_len = snprintf(url, sizeof(url), "%s/releases/tags/%s",
+                           mirror_url, release_tag);
+    else if (sanitize_font_name(catalog.names[0], safe_name,
+                                sizeof(safe_name)))
+        url_len = snprintf(url, sizeof(url), DOWNLOAD_BASE_URL "/%s/%s.zip",
+                           release_tag, safe_name);
+    if (url_len > 0 && url_len < (int)sizeof(url) &&
+        (warmup.curl = curl_easy_init())) {
+        warmup.started = monotonic_seconds();
+        curl_easy_setopt(warmup.curl, CURLOPT_URL, url);
+        curl_easy_setopt(warmup.curl, CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(warmup.curl, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(warmup.curl, CURLOPT_USERAGENT,
+                         "nerdfonts-installer/1.0");
+        curl_easy_setopt(warmup.curl, CURLOPT_CONNECTTIMEOUT, 10L);
+        share_connections(warmup.curl);
+        trace_watch(warmup.curl, &warmup.hops);
+        curl_multi_add_handle(prefetch_multi, warmup.curl);
+    }
+
+    if (prefetch_list) {
+        int candidates[PREFETCH_MAX];
+        int n = prefetch_candidates(candidates);
+        char cache_dir[MAX_PATH_LEN];
+        struct FsInfo cache_fs = {0};
+        if (snprintf(cache_dir, sizeof(cache_dir), "%s/archives",
+                     cache_path) < (int)sizeof(cache_dir) &&
+            create_directory_secure(cache_dir) == 0)
+            cache_fs = fs_info(cache_dir);
+
+        for (int i = 0; i < n; i++)
+            prefetch_font(candidates[i], &cache_fs);
+        if (prefetch_count > 0) {
+            printf("%sPrefetching", COLOR_BLUE);
+            for (int i = 0; i < prefetch_count; i++)
+                printf("%s %s", i > 0 ? "," : "",
+                       catalog.names[prefetches[i].font_idx]);
+            printf(" while you choose\n%s", COLOR_RESET);
+        }
+        prefetch_share_rate();
+    }
+
+    // Send the first requests now; the prompt drives the rest.
+    int running;
+    curl_multi_perform(prefetch_multi, &running);
+}
+
+// Collect finished prompt-time transfers.  A prefetched archive enters the
+// cache only once it matches the catalog digest (or size).
+static void prefetch_reap(void) {
+    CURLMsg *msg;
+    int queued, finished = 0;
+
+    while ((msg = curl_multi_info_read(prefetch_multi, &queued)) != NULL) {
+        if (msg->msg != CURLMSG_DONE)
+            continue;
+        CURL *easy = msg->easy_handle;
+        CURLcode res = msg->data.result;
+        curl_multi_remove_handle(prefetch_multi, easy);
+
+        if (easy == warmup.curl) {
+            trace_transfer(&warmup.hops, TRACE_LANE_PREFETCH, warmup.started,
+                           curl_easy_strerror(res));
+            transfer_close(&warmup);
+            continue;
+        }
+        for (int i = 0; i < prefetch_count; i++) {
+            struct Prefetch *p = &prefetches[i];
+            if (p->t.curl != easy)
+                continue;
+            int idx = p->font_idx;
+            trace_transfer(&p->t.hops, TRACE_LANE_PREFETCH, p->t.started,
+                           curl_easy_strerror(res));
+            int ok = transfer_close(&p->t) == 0 && res == CURLE_OK &&
+                     cached_archive_valid(p->t.path,
+                                          catalog.has_digest[idx]
+                                              ? catalog.digests[idx] : NULL,
+                                          catalog.sizes[idx]) &&
+                     rename(p->t.path, p->cached) == 0;
+            if (!ok)
+                secure_unlink(p->t.path);
+            p->state = ok ? PREFETCH_DONE : PREFETCH_FAILED;
+            prefetch_parts[i][0] = '\0';
+            finished = 1;
+        }
+    }
+    if (finished)
+        prefetch_share_rate();
+}
+
+// Wait for the pager to exit, driving prompt-time transfers meanwhile so
+// the time spent reading the list is not lost to them.  The pager owns the
+// terminal, so its exit is checked every PREFETCH_PAGER_POLL_MS.
+static void prefetch_wait_for_pager(pid_t pager) {
+    if (pager == -1)
+        return;
+
+    int running = 1;
+    while (prefetch_multi && running) {
+        pid_t done = waitpid(pager, NULL, WNOHANG);
+        if (done == pager || (done == -1 && errno != EINTR))
+            return;
+        if (curl_multi_perform(prefetch_multi, &running) != CURLM_OK)
+            break;
+        prefetch_reap();
+        if (running)
+            curl_multi_poll(prefetch_multi, NULL, 0, PREFETCH_PAGER_POLL_MS,
+                            NULL);
+    }
+    while (waitpid(pager, NULL, 0) == -1 && errno == EINTR)
+        ;
+}
+
+// Block until the terminal has input, driving prompt-time transfers
+// meanwhile.  Returns at once when there are none left.
+static void prefetch_wait_for_input(FILE *tty) {
+    struct curl_waitfd input = { fileno(tty), CURL_WAIT_POLLIN, 0 };
+    int running = 1;
+
+    while (prefetch_multi && running) {
+        if (curl_multi_perform(prefetch_multi, &running) != CURLM_OK)
+            break;
+        prefetch_reap();
+        input.revents = 0;
+        if (!running ||
+            curl_multi_poll(prefetch_multi, &input, 1, 1000, NULL) != CURLM_OK ||
+            input.revents != 0)
+            break;
+    }
+}
+
+// The choice is made: cancel prefetches of fonts that were not selected
+// and finish the others.  Leaves nothing running.
+static void prefetch_finish(const int *selected, int num_selected) {
+    if (!prefetch_multi)
+        return;
+
+    if (warmup.curl) {
+        curl_multi_remove_handle(prefetch_multi, warmup.curl);
+        trace_transfer(&warmup.hops, TRACE_LANE_PREFETCH, warmup.started,
+                       "cancelled");
+        transfer_close(&warmup);
+    }
+
+    int waiting = 0;
+    for (int i = 0; i < prefetch_count; i++) {
+        struct Prefetch *p = &prefetches[i];
+        if (p->state != PREFETCH_RUNNING)
+            continue;
+        int wanted = 0;
+        for (int j = 0; j < num_selected; j++)
+            wanted |= selected[j] == p->font_idx;
+        if (wanted) {
+            waiting++;
+            continue;
+        }
+        curl_multi_remove_handle(prefetch_multi, p->t.curl);
+        trace_transfer(&p->t.hops, TRACE_LANE_PREFETCH, p->t.started,
+                       "cancelled");
+        transfer_close(&p->t);
+        secure_unlink(p->t.path);
+        p->state = PREFETCH_FAILED;
+        prefetch_parts[i][0] = '\0';
+    }
+
+    if (waiting > 0) {
+        prefetch_share_rate();
+        printf("%sFinishing %d prefetched download%s\n%s", COLOR_BLUE,
+               waiting, waiting == 1 ? "" : "s", COLOR_RESET);
+        int running = 1;
+        while (running) {
+            if (curl_multi_perform(prefetch_multi, &running) != CURLM_OK)
+                break;
+            prefetch_reap();
+            if (running)
+                curl_multi_poll(prefetch_multi, NULL, 0, 1000, NULL);
+        }
+        prefetch_reap();
+    }
+
+    // Anything still open failed to complete; install_font() downloads it.
+    for (int i = 0; i < prefetch_count; i++) {
+        struct Prefetch *p = &prefetches[i];
+        if (p->state != PREFETCH_RUNNING)
+            continue;
+        curl_multi_remove_handle(prefetch_multi, p->t.curl);
+        transfer_close(&p->t);
+        secure_unlink(p->t.path);
+        p->state = PREFETCH_FAILED;
+        prefetch_parts[i][0] = '\0';
+    }
+    curl_multi_cleanup(prefetch_multi);
+    prefetch_multi = NULL;
+}
+
+// Without --keep-archives, archives that only exist because of a prefetch
+// are removed again once the install is over.
+static void prefetch_discard(void) {
+    if (keep_archives)
+        return;
+    for (int i = 0; i < prefetch_count; i++) {
+        if (prefetches[i].state == PREFETCH_DONE)
+            secure_unlink(prefetches[i].cached);
+    }
+    prefetch_count = 0;
+}
+
+// ============================================================================
+// PRUNE
+// ============================================================================
+
+// Case-insensitive membership test for a comma-separated list.
+static int list_contains(const char *list, const char *item) {
+    size_t item_len = strlen(item); // flawfinder: ignore
+    const char *p = list;
+    while (*p) {
+        const char *comma = strchr(p, ',');
+        size_t len = comma ? (size_t)(comma - p) : strlen(p); // flawfinder: ignore
+        if (len == item_len && strncasecmp(p, item, len) == 0)
+            return 1;
+        if (!comma)
+            break;
+        p = comma + 1;
+    }
+    return 0;
+}
+
+// Split a Nerd Fonts file name ("<Family>NerdFont<Spacing>-<Style>.<ext>")
+// into its variant parts; an empty spacing is reported as "default".
+// Returns 0 for anything else (licences, readmes, legacy "Nerd Font
+// Complete" names), which prune always keeps.
+static int parse_font_variant(const char *path, char *spacing,
+                              char *style, char *ext, size_t part_size) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+
+    const char *marker = strstr(base, "NerdFont");
+    const char *dash   = strrchr(base, '-');
+    const char *dot    = strrchr(base, '.');
+    if (!marker || !dash || !dot)
+        return 0;
+
+    size_t spacing_at = (size_t)(marker - base) + 8;
+    size_t dash_at    = (size_t)(dash - base);
+    size_t dot_at     = (size_t)(dot - base);
+    if (dash_at < spacing_at || dot_at <= dash_at + 1)
+        return 0;
+
+    size_t spacing_len = dash_at - spacing_at;
+    size_t style_len   = dot_at - dash_at - 1;
+    size_t ext_len     = strlen(dot + 1); // flawfinder: ignore
+    if (spacing_len >= part_size || style_len >= part_size ||
+        ext_len == 0 || ext_len >= part_size)
+        return 0;
+
+    if (spacing_len == 0)
+        snprintf(spacing, part_size, "default");
+    else
+        snprintf(spacing, part_size, "%.*s", (int)spacing_len, marker + 8);
+    snprintf(style, part_size, "%.*s", (int)style_len, dash + 1);
+    snprintf(ext, part_size, "%s", dot + 1);
+
+    return strcasecmp(ext, "ttf") == 0 || strcasecmp(ext, "otf") == 0;
+}
+
+static int prune_wants_removal(const struct PruneFilter *filter,
+                               const char *entry, int *is_font) {
+    char spacing[64], style[64], ext[64];
+    *is_font = parse_font_variant(entry, spacing, style, ext, sizeof(spacing));
+    if (!*is_font)
+        return 0;
+    return !list_contains(filter->spacing, spacing) ||
+           !list_contains(filter->formats, ext) ||
+           !list_contains(filter->styles, style);
+}
+
+static FILE *open_manifest(const char *family_dir) {
+    char manifest[MAX_PATH_LEN];
+    if (snprintf(manifest, sizeof(manifest), "%s/" MANIFEST_NAME,
+                 family_dir) >= (int)sizeof(manifest))
+        return NULL;
+    return fopen(manifest, "r");
+}
+
+// Remove the copies of a family's files that an older version unpacked
+// straight into fonts_path.  The family's own directory holds the files
+// its manifest lists, so these are duplicates that fontconfig registers
+// twice.  Returns the number of files (to be) removed.
+static int prune_flat_copies(const char *family_dir, int dry_run,
+                             uint64_t *bytes_out) {
+    FILE *fp = open_manifest(family_dir);
+    if (!fp)
+        return 0;
+
+    char line[MAX_PATH_LEN], path[MAX_PATH_LEN * 2];
+    int removed = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (strstr(line, "..") != NULL || !has_flat_copy(line))
+            continue;
+
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", fonts_path, line);
+        if (lstat(path, &st) != 0)
+            continue;
+        if (dry_run) {
+            char size[32];
+            format_size((uint64_t)st.st_size, size, sizeof(size));
+            printf("  %s (%s)\n", path, size);
+        } else if (secure_unlink(path) != 0) {
+            printf("%sFailed to remove %s: %s\n%s",
+                   COLOR_RED, path, strerror(errno), COLOR_RESET);
+            continue;
+        }
+        removed++;
+        *bytes_out += (uint64_t)st.st_size;
+    }
+    fclose(fp);
+    return removed;
+}
+
+// Remove the unwanted variants among the files listed in list, one path
+// per line relative to dir (fonts_path or a family directory in it).
+// A filter that would leave no font files at all
+// is treated as a mistake and the family is skipped.  Returns the number of
+// files (to be) removed.
+static int prune_listed(FILE *list, const char *dir, const char *family,
+                        const struct PruneFilter *filter, int dry_run,
+                        uint64_t *bytes_out) {
+    char line[MAX_PATH_LEN], path[MAX_PATH_LEN * 2];
+    int kept_fonts = 0, removable = 0;
+    struct stat st;
+
+    // Pass 1: make sure something survives, counting only what is on disk.
+    while (fgets(line, sizeof(line), list)) {
+        line[strcspn(line, "\n")] = '\0';
+        int is_font;
+        if (line[0] == '/' || strstr(line, "..") != NULL ||
+            snprintf(path, sizeof(path), "%s/%s", dir, line) >=
+                (int)sizeof(path) ||
+            lstat(path, &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        if (prune_wants_removal(filter, line, &is_font))
+            removable++;
+        else if (is_font)
+            kept_fonts++;
+    }
+
+    if (removable == 0 || kept_fonts == 0) {
+        if (removable > 0)
+            printf("%s%s: filter keeps no font files; skipped\n%s",
+                   COLOR_YELLOW, family, COLOR_RESET);
+        return 0;
+    }
+
+    // Pass 2: remove (or report) them.
+    rewind(list);
+    int removed = 0;
+    uint64_t bytes = 0;
+
+    while (fgets(line, sizeof(line), list)) {
+        line[strcspn(line, "\n")] = '\0';
+        int is_font;
+        if (line[0] == '/' || strstr(line, "..") != NULL ||
+            !prune_wants_removal(filter, line, &is_font) ||
+            snprintf(path, sizeof(path), "%s/%s", dir, line) >=
+                (int)sizeof(path) ||
+            lstat(path, &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+
+        if (dry_run) {
+            char size[32];
+            format_size((uint64_t)st.st_size, size, sizeof(size));
+            printf("  %s (%s)\n", path + strlen(fonts_path) + 1, size); // flawfinder: ignore
+        } else if (secure_unlink(path) != 0) {
+            printf("%sFailed to remove %s: %s\n%s",
+                   COLOR_RED, path, strerror(errno), COLOR_RESET);
+            continue;
+        }
+        removed++;
+        bytes += (uint64_t)st.st_size;
+    }
+
+    *bytes_out += bytes;
+    return removed;
+}
+
+// Remove one family's unwanted variants, as listed in its manifest.
+static int prune_family(const char *family_dir, const char *family,
+                        const struct PruneFilter *filter, int dry_run,
+                        uint64_t *bytes_out) {
+    FILE *fp = open_manifest(family_dir);
+    if (!fp)
+        return 0;
+
+    int removed = prune_listed(fp, family_dir, family, filter, dry_run,
+                               bytes_out);
+    fclose(fp);
+    return removed;
+}
+
+// Families installed by older versions have no manifest: their archives
+// were unpacked straight into fonts_path.  Their file lists come from the
+// archives instead, matched against what is in fonts_path.
+
+struct FlatList {
+    FILE *fp;
+    int   found;
+};
+
+static int flat_list_entry(const struct ZipEntry *entry, void *ctx) {
+    struct FlatList *flat = ctx;
+    char name[MAX_PATH_LEN];
+    if (zip_entry_safe_name(entry, name, sizeof(name)) &&
+        has_flat_copy(name)) {
+        fprintf(flat->fp, "%s\n", name);
+        flat->found++;
+    }
+    return 0;
+}
+
+// Walk the central directory of an archive that is not cached, fetching
+// only its tail: one range request for the end record (and usually the
+// whole directory), and one more if the directory starts earlier.  The
+// directory is re-based to offset 0 so zip_for_each_entry() can walk it.
+static long zip_list_remote(const char *url, uint64_t size, zip_entry_fn fn,
+                            void *ctx) {
+    struct HTTPResponse tail = {0}, head = {0};
+    unsigned char *dir = NULL;
+    char range[64];
+    long count = -1;
+
+    if (size < ZIP_EOCD_LEN)
+        return -1;
+
+    uint64_t tail_start = size > ZIP_EOCD_LEN + ZIP_MAX_COMMENT
+                        ? size - ZIP_EOCD_LEN - ZIP_MAX_COMMENT : 0;
+    snprintf(range, sizeof(range), "%llu-%llu",
+             (unsigned long long)tail_start, (unsigned long long)size - 1);
+    if (fetch_to_memory(url, range, &tail) != CURLE_OK)
+        goto done;
+
+    // A server that ignores the range sends the whole archive.
+    if (tail.size == size) {
+        count = zip_for_each_entry((const unsigned char *)tail.memory,
+                                   tail.size, fn, ctx);
+        goto done;
+    }
+
+    uint32_t cd_off, cd_size;
+    long eocd = tail.size == size - tail_start
+              ? zip_find_end((const unsigned char *)tail.memory, tail.size,
+                             &cd_off, &cd_size)
+              : -1;
+    if (eocd < 0 ||
+        (uint64_t)cd_off + cd_size != tail_start + (uint64_t)eocd)
+        goto done;
+
+    dir = malloc((size_t)cd_size + ZIP_EOCD_LEN);
+    if (!dir)
+        goto done;
+
+    size_t head_len = cd_off < tail_start ? (size_t)(tail_start - cd_off) : 0;
+    if (head_len > 0) {
+        snprintf(range, sizeof(range), "%lu-%llu", (unsigned long)cd_off,
+                 (unsigned long long)tail_start - 1);
+        if (fetch_to_memory(url, range, &head) != CURLE_OK ||
+            head.size != head_len)
+            goto done;
+        memcpy(dir, head.memory, head_len); // flawfinder: ignore
+    }
+    memcpy(dir + head_len, // flawfinder: ignore
+           tail.memory + (cd_off + head_len - tail_start),
+           cd_size - head_len);
+
+    // The end record, pointing at offset 0 and without its comment.
+    memcpy(dir + cd_size, tail.memory + eocd, ZIP_EOCD_LEN); // flawfinder: ignore
+    memset(dir + cd_size + 16, 0, 4);
+    memset(dir + cd_size + 20, 0, 2);
+    count = zip_for_each_entry(dir, (size_t)cd_size + ZIP_EOCD_LEN, fn, ctx);
+
+done:
+    free(dir);
+    free(head.memory);
+    free(tail.memory);
+    return count;
+}
+
+// List catalog family font_idx's archive through fn: a cached copy from
+// this release or an older one, or else the release asset's directory.
+static long list_family_archive(int font_idx, zip_entry_fn fn, void *ctx) {
+    const char *name = catalog.names[font_idx];
+    char path[MAX_PATH_LEN], base_tag[MAX_TAG_LEN];
+    struct stat st;
+
+    if ((archive_cache_path(release_tag, name, path, sizeof(path)) &&
+         lstat(path, &st) == 0 && S_ISREG(st.st_mode)) ||
+        find_delta_base(release_tag, name, path, sizeof(path), base_tag,
+                        sizeof(base_tag))) {
+        long count = zip_list_file(path, fn, ctx);
+        if (count >= 0)
+            return count;
+    }
+
+    if (snprintf(path, sizeof(path), DOWNLOAD_BASE_URL "/%s/%s.zip",
+                 release_tag, name) >= (int)sizeof(path))
+        return -1;
+    return zip_list_remote(path, catalog.sizes[font_idx], fn, ctx);
+}
+
+// Prune catalog family font_idx where it was unpacked into fonts_path.
+// Returns the number of files (to be) removed, or -1 if none of the
+// archive's files are there (or its file list could not be read).
+static int prune_flat_family(int font_idx, const struct PruneFilter *filter,
+                             int dry_run, uint64_t *bytes_out) {
+    struct FlatList flat = { tmpfile(), 0 };
+    if (!flat.fp)
+        return -1;
+
+    int removed = -1;
+    if (list_family_archive(font_idx, flat_list_entry, &flat) >= 0 &&
+        flat.found > 0) {
+        rewind(flat.fp);
+        removed = prune_listed(flat.fp, fonts_path, catalog.names[font_idx],
+                               filter, dry_run, bytes_out);
+    }
+    fclose(flat.fp);
+    return removed;
+}
+
+// Are there font files directly in fonts_path?
+static int flat_fonts_present(void) {
+    char spacing[64], style[64], ext[64];
+    DIR *dir = opendir(fonts_path);
+    struct dirent *ent;
+    int found = 0;
+
+    while (dir && !found && (ent = readdir(dir)) != NULL)
+        found = has_flat_copy(ent->d_name) &&
+                parse_font_variant(ent->d_name, spacing, style, ext,
+                                   sizeof(spacing));
+    if (dir)
+        closedir(dir);
+    return found;
+}
+
+// The catalog of the newest indexed release, asking GitHub for the latest
+// one if the index is empty.  Loaded once; returns 0 if unavailable.
+static int prune_load_catalog(void) {
+    static int loaded = -1;
+    if (loaded >= 0)
+        return loaded;
+
+    open_release_index();
+    const struct IndexRelease *rel = index_latest_release();
+    if (!rel) {
+        (void)create_directory_secure(cache_path);
+        json_t *root = fetch_json(API_BASE_URL "/latest", 1);
+        if (root && json_is_object(root))
+            (void)index_merge_releases(&root, 1);
+        if (root)
+            json_decref(root);
+        rel = index_latest_release();
+    }
+
+    loaded = 0;
+    if (rel) {
+        snprintf(release_tag, sizeof(release_tag), "%s",
+                 index_string(rel->tag_off));
+        load_fonts_from_index(rel);
+        loaded = catalog.count > 0;
+    }
+    if (!loaded)
+        printf("%sCould not load the font catalog; families unpacked into "
+               "%s are skipped\n%s", COLOR_YELLOW, fonts_path, COLOR_RESET);
+    return loaded;
+}
 
-    res = curl_easy_perform(curl);
-    fclose(fp);
-    curl_easy_cleanup(curl);
+static void print_prune_usage(const char *prog) {
+    printf("Usage: %s prune [options] [FAMILY...]\n\n"
+           "Remove unwanted variants from installed font families.\n"
+           "Without FAMILY arguments every installed family is pruned.\n\n"
+           "Options:\n"
+           "  --spacing LIST    Spacing variants to keep: default, mono, "
+           "propo\n"
+           "                    (default: " PRUNE_DEFAULT_SPACING ")\n"
+           "  --format LIST     Formats to keep: ttf, otf "
+           "(default: " PRUNE_DEFAULT_FORMATS ")\n"
+           "  --styles LIST     Styles to keep\n"
+           "                    (default: " PRUNE_DEFAULT_STYLES ")\n"
+           "  -n, --dry-run     List the files that would be removed\n"
+           "  -h, --help        Show this help and exit\n\n"
+           "LIST is comma-separated and case-insensitive.\n", prog);
+}
 
-    if (res != CURLE_OK) {
-        printf("%sFailed to download %s: %s\n%s",
-               COLOR_RED, font_name, curl_easy_strerror(res), COLOR_RESET);
-        cleanup_zip();
-        return 0;
+// `prune` subcommand (argv[1] == "prune").  Works from the per-family
+// manifests written at install time, and for families installed by older
+// (flat-layout) versions from their archives' file lists.  Flat copies of
+// a reinstalled family are removed here, not by the install.
+static int run_prune(int argc, char *argv[]) {
+    struct PruneFilter filter = {
+        PRUNE_DEFAULT_SPACING, PRUNE_DEFAULT_FORMATS, PRUNE_DEFAULT_STYLES
+    };
+    int dry_run = 0;
+    int first_family = argc;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_prune_usage(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "-n") == 0 ||
+                   strcmp(argv[i], "--dry-run") == 0) {
+            dry_run = 1;
+        } else if (strcmp(argv[i], "--spacing") == 0 && i + 1 < argc) {
+            filter.spacing = argv[++i];
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            filter.formats = argv[++i];
+        } else if (strcmp(argv[i], "--styles") == 0 && i + 1 < argc) {
+            filter.styles = argv[++i];
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Error: Unknown option: %s\n\n", argv[i]);
+            print_prune_usage(argv[0]);
+            return 1;
+        } else {
+            first_family = i;
+            break;
+        }
     }
 
-    if (secure_unzip(current_zip_path, fonts_path) != 0) {
-        printf("%sFailed to extract %s\n%s",
-               COLOR_RED, font_name, COLOR_RESET);
-        cleanup_zip();
-        return 0;
+    resolve_user_paths();
+
+    // Candidate families: the ones named, or every directory in fonts_path
+    // plus, if fonts were unpacked straight into it, every catalog family
+    // without a manifest.
+    // Directories without a manifest are not looked for in fonts_path.
+    int    nfamilies = 0, flat_from = 0;
+    char (*families)[MAX_FONT_NAME_LEN] =
+        calloc(2 * MAX_FONTS, sizeof(*families));
+    if (!families) {
+        printf("%s", COLOR_RED "Error: Out of memory\n" COLOR_RESET);
+        return 1;
     }
 
-    cleanup_zip();
-    printf("%s✓ %s installed successfully\n%s",
-           COLOR_GREEN, font_name, COLOR_RESET);
-    return 1;
-}
+    if (first_family < argc) {
+        for (int i = first_family; i < argc && nfamilies < MAX_FONTS; i++) {
+            if (!sanitize_font_name(argv[i], families[nfamilies],
+                                    MAX_FONT_NAME_LEN)) {
+                printf("%sError: Invalid font family: %s\n%s",
+                       COLOR_RED, argv[i], COLOR_RESET);
+                free(families);
+                return 1;
+            }
+            nfamilies++;
+        }
+    } else {
+        DIR *dir = opendir(fonts_path);
+        struct dirent *ent;
+        while (dir && (ent = readdir(dir)) != NULL && nfamilies < MAX_FONTS) {
+            if (sanitize_font_name(ent->d_name, families[nfamilies],
+                                   MAX_FONT_NAME_LEN))
+                nfamilies++;
+        }
+        if (dir)
+            closedir(dir);
+
+        flat_from = nfamilies;
+        if (flat_fonts_present() && prune_load_catalog()) {
+            for (int i = 0; i < catalog.count; i++) {
+                char manifest[MAX_PATH_LEN];
+                if (snprintf(manifest, sizeof(manifest),
+                             "%s/%s/" MANIFEST_NAME, fonts_path,
+                             catalog.names[i]) < (int)sizeof(manifest) &&
+                    access(manifest, R_OK) != 0) // flawfinder: ignore
+                    snprintf(families[nfamilies++], MAX_FONT_NAME_LEN, "%s",
+                             catalog.names[i]);
+            }
+        }
+    }
 
-// Rebuild the font cache via fc-cache.
-static void update_font_cache(void) {
-    pid_t pid = fork();
-    if (pid == -1) {
-        printf("%s", COLOR_YELLOW "Warning: Failed to fork for font cache "
-               "update\n" COLOR_RESET);
-        return;
+    const char **touched = calloc(2 * MAX_FONTS + 1, sizeof(*touched));
+    char (*dirs)[MAX_PATH_LEN] = calloc(2 * MAX_FONTS, sizeof(*dirs));
+    if (!touched || !dirs) {
+        printf("%s", COLOR_RED "Error: Out of memory\n" COLOR_RESET);
+        free(families);
+        free(touched);
+        free(dirs);
+        return 1;
     }
 
-    if (pid == 0) {
-        int devnull = open("/dev/null", O_WRONLY);
-        if (devnull != -1) {
-            dup2(devnull, STDOUT_FILENO);
-            dup2(devnull, STDERR_FILENO);
-            close(devnull);
+    size_t ntouched = 0;
+    int    total_files = 0, installed = 0, flat_touched = 0;
+    uint64_t total_bytes = 0;
+
+    for (int i = 0; i < nfamilies; i++) {
+        char manifest[MAX_PATH_LEN];
+        if (snprintf(dirs[i], MAX_PATH_LEN, "%s/%s", fonts_path,
+                     families[i]) >= MAX_PATH_LEN ||
+            snprintf(manifest, sizeof(manifest), "%s/" MANIFEST_NAME,
+                     dirs[i]) >= (int)sizeof(manifest) ||
+            access(manifest, R_OK) != 0) { // flawfinder: ignore
+            // No manifest: look for the family in fonts_path itself.
+            int idx = i >= flat_from && prune_load_catalog()
+                    ? catalog_find(families[i]) : -1;
+            uint64_t bytes = 0;
+            int files = idx >= 0
+                      ? prune_flat_family(idx, &filter, dry_run, &bytes)
+                      : -1;
+            if (files < 0) {
+                if (first_family < argc)
+                    printf("%s%s: not installed; skipped\n%s",
+                           COLOR_YELLOW, families[i], COLOR_RESET);
+                continue;
+            }
+            installed++;
+            if (files > 0) {
+                char size[32];
+                format_size(bytes, size, sizeof(size));
+                printf("%s%s: %s %d file%s from %s (%s)\n%s", COLOR_BLUE,
+                       catalog.names[idx],
+                       dry_run ? "would remove" : "removed", files,
+                       files == 1 ? "" : "s", fonts_path, size, COLOR_RESET);
+                flat_touched = 1;
+                total_files += files;
+                total_bytes += bytes;
+            }
+            continue;
+        }
+        installed++;
+
+        uint64_t bytes = 0;
+        int files = prune_flat_copies(dirs[i], dry_run, &bytes);
+        if (files > 0) {
+            char size[32];
+            format_size(bytes, size, sizeof(size));
+            printf("%s%s: %s %d older cop%s from %s (%s)\n%s", COLOR_BLUE,
+                   families[i], dry_run ? "would remove" : "removed", files,
+                   files == 1 ? "y" : "ies", fonts_path, size, COLOR_RESET);
+            flat_touched = 1;
+            total_files += files;
+            total_bytes += bytes;
+        }
+
+        bytes = 0;
+        files = prune_family(dirs[i], families[i], &filter, dry_run, &bytes);
+        if (files > 0) {
+            char size[32];
+            format_size(bytes, size, sizeof(size));
+            printf("%s%s: %s %d file%s (%s)\n%s", COLOR_BLUE, families[i],
+                   dry_run ? "would remove" : "removed", files,
+                   files == 1 ? "" : "s", size, COLOR_RESET);
+            touched[ntouched++] = dirs[i];
+            total_files += files;
+            total_bytes += bytes;
         }
-        execlp("fc-cache", "fc-cache", "-f", (char *)NULL); // flawfinder: ignore
-        _exit(127);
     }
 
-    int status;
-    waitpid(pid, &status, 0);
-    if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
-        printf("%s", COLOR_GREEN "✓ Font cache updated\n" COLOR_RESET);
-    else
-        printf("%s", COLOR_YELLOW "Warning: Font cache update failed, "
-               "but fonts were installed\n" COLOR_RESET);
+    if (installed == 0) {
+        printf("%sNo prunable families in %s\n%s",
+               COLOR_YELLOW, fonts_path, COLOR_RESET);
+    } else {
+        char size[32];
+        format_size(total_bytes, size, sizeof(size));
+        printf("%s%s %d file%s, %s reclaimed\n%s", COLOR_GREEN,
+               dry_run ? "Dry run:" : "✓ Pruned", total_files,
+               total_files == 1 ? "" : "s", size, COLOR_RESET);
+    }
+
+    if (flat_touched)
+        touched[ntouched++] = fonts_path;
+    if (!dry_run && ntouched > 0)
+        update_font_cache(touched, ntouched);
+
+    free(families);
+    free(touched);
+    free(dirs);
+    return 0;
 }
 
 // Prompt for font selection and populate selected_indices[].
@@ -800,11 +3923,17 @@ static void get_font_selection(int *selected_indices, int *num_selected) {
         if (ferror(tty))
             clearerr(tty);
 
+        fflush(stdout);
+        prefetch_wait_for_input(tty);
+
         if (fgets(input, sizeof(input), tty) == NULL) {
             if (feof(tty)) {
                 fprintf(stderr, "\nError: No font selected (EOF on input). Exiting.\n");
                 fclose(tty);
+                prefetch_finish(NULL, 0);
+                prefetch_discard();
                 full_cleanup();
+                curl_share_cleanup(curl_share);
                 curl_global_cleanup();
                 exit(EXIT_FAILURE);
             }
@@ -827,8 +3956,8 @@ static void get_font_selection(int *selected_indices, int *num_selected) {
         }
 
         if (strcmp(input, "all") == 0) {
-            *num_selected = font_count;
-            for (int i = 0; i < font_count; i++)
+            *num_selected = catalog.count;
+            for (int i = 0; i < catalog.count; i++)
                 selected_indices[i] = i;
             break;
         }
@@ -840,9 +3969,9 @@ static void get_font_selection(int *selected_indices, int *num_selected) {
         while (token != NULL && *num_selected < MAX_FONTS) {
             char *endptr;
             long sel = strtol(token, &endptr, 10);
-            if (*endptr != '\0' || sel < 1 || sel > font_count) {
+            if (*endptr != '\0' || sel < 1 || sel > catalog.count) {
                 printf("%sError: Invalid selection. Enter numbers 1–%d.\n%s",
-                       COLOR_RED, font_count, COLOR_RESET);
+                       COLOR_RED, catalog.count, COLOR_RESET);
                 valid = 0;
                 break;
             }
@@ -858,40 +3987,908 @@ static void get_font_selection(int *selected_indices, int *num_selected) {
     fclose(tty);
 }
 
-int main(void) {
+// ============================================================================
+// SERVE (LAN mirror)
+// ============================================================================
+//
+// Routes, mirroring the parts of the GitHub API the client uses:
+//   GET /releases/latest           newest release in the index (JSON)
+//   GET /releases/tags/<tag>       one release from the index (JSON)
+//   GET /download/<tag>/<name>.zip archive from the cache (ranges allowed)
+//   GET /download/<tag>/<name>.zip.blocks
+//                                  block index for --delta clients
+// Catalog misses and archive misses are filled from GitHub on demand, so a
+// LAN only downloads each archive once.  Clients verify digests themselves.
+
+static const struct IndexAsset *index_find_asset(
+        const struct IndexRelease *rel, const char *name) {
+    const struct IndexAsset *assets = index_assets() + rel->first_asset;
+    for (uint32_t i = 0; i < rel->asset_count; i++) {
+        if (strcmp(index_string(assets[i].name_off), name) == 0)
+            return &assets[i];
+    }
+    return NULL;
+}
+
+// Render an indexed release in the shape of the GitHub releases API.
+static json_t *release_to_json(const struct IndexRelease *rel) {
+    json_t *obj    = json_object();
+    json_t *assets = json_array();
+    if (!obj || !assets) {
+        json_decref(obj);
+        json_decref(assets);
+        return NULL;
+    }
+
+    json_object_set_new(obj, "tag_name",
+                        json_string(index_string(rel->tag_off)));
+    if (rel->published) {
+        char ts[32];
+        struct tm tm;
+        time_t t = (time_t)rel->published;
+        if (gmtime_r(&t, &tm) &&
+            strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%SZ", &tm) > 0)
+            json_object_set_new(obj, "published_at", json_string(ts));
+    }
+
+    const struct IndexAsset *a = index_assets() + rel->first_asset;
+    for (uint32_t i = 0; i < rel->asset_count; i++) {
+        char name[MAX_FONT_NAME_LEN + 8];
+        char digest[8 + 2 * SHA256_LEN + 1];
+        json_t *asset = json_object();
+        if (!asset)
+            continue;
+
+        snprintf(name, sizeof(name), "%s.zip", index_string(a[i].name_off));
+        json_object_set_new(asset, "name", json_string(name));
+        json_object_set_new(asset, "size", json_integer((json_int_t)a[i].size));
+        if (a[i].flags & ASSET_HAS_DIGEST) {
+            int off = snprintf(digest, sizeof(digest), "sha256:");
+            for (size_t j = 0; j < SHA256_LEN; j++)
+                off += snprintf(digest + off, sizeof(digest) - (size_t)off,
+                                "%02x", a[i].sha256[j]);
+            json_object_set_new(asset, "digest", json_string(digest));
+        }
+        json_array_append_new(assets, asset);
+    }
+    json_object_set_new(obj, "assets", assets);
+    return obj;
+}
+
+// <cache_path>/checked/<tag>: an empty file whose mtime is when serve last
+// asked GitHub about the tag.  releases/latest is stamped as LATEST_STAMP,
+// which is not a release tag.
+
+static int tag_stamp_path(const char *tag, char *out, size_t out_size) {
+    int n = snprintf(out, out_size, "%s/checked/%s", cache_path, tag);
+    return n > 0 && (size_t)n < out_size;
+}
+
+static int tag_checked_recently(const char *tag) {
+    char path[MAX_PATH_LEN];
+    struct stat st;
+    return tag_stamp_path(tag, path, sizeof(path)) && stat(path, &st) == 0 &&
+           time(NULL) - st.st_mtime < CATALOG_TTL;
+}
+
+static void tag_mark_checked(const char *tag) {
+    char path[MAX_PATH_LEN], dir[MAX_PATH_LEN];
+    if (!tag_stamp_path(tag, path, sizeof(path)))
+        return;
+
+    snprintf(dir, sizeof(dir), "%s", path);
+    *strrchr(dir, '/') = '\0';
+    if (create_directory_secure(dir) != 0)
+        return;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd == -1)
+        return;
+    close(fd);
+    utimensat(AT_FDCWD, path, NULL, 0);
+}
+
+// Nerd Fonts tags are versions: "v3.3.0", or with a suffix as in
+// "v3.0.0-rc1".  Anything else is not worth an API call.
+static int release_tag_plausible(const char *tag) {
+    const char *p = tag + (tag[0] == 'v');
+    if (!isdigit((unsigned char)*p))
+        return 0;
+    while (isdigit((unsigned char)*p) || *p == '.')
+        p++;
+    if (*p == '-' && isalnum((unsigned char)p[1])) {
+        for (p++; isalnum((unsigned char)*p) || *p == '.'; p++)
+            ;
+    }
+    return *p == '\0';
+}
+
+// Bring the index up to date for one request.  Workers are forked, so the
+// mapping is reopened to see what other workers merged.  Clients cannot
+// spend the host's API quota: releases/latest, tags that are missing from
+// the index and tags whose assets may still be uploading are each asked
+// upstream at most once per CATALOG_TTL, whatever the answer, and tags that
+// do not look like releases are never asked.
+static void serve_refresh_catalog(const char *tag) {
+    char url[MAX_PATH_LEN];
+
+    close_release_index();
+    open_release_index();
+
+    if (tag) {
+        const struct IndexRelease *rel = index_find_release(tag);
+        if ((rel && index_release_settled(rel)) ||
+            !release_tag_plausible(tag) || tag_checked_recently(tag))
+            return;
+        snprintf(url, sizeof(url), API_BASE_URL "/tags/%s", tag);
+    } else {
+        if (tag_checked_recently(LATEST_STAMP))
+            return;
+        snprintf(url, sizeof(url), API_BASE_URL "/latest");
+    }
+
+    // Stamp before asking, so concurrent workers do not all go upstream.
+    tag_mark_checked(tag ? tag : LATEST_STAMP);
+    json_t *root = fetch_json(url, 1);
+    if (root && json_is_object(root))
+        (void)index_merge_releases(&root, 1);
+    if (root)
+        json_decref(root);
+}
+
+// extra holds any further header lines, each ending in CRLF.
+static void send_headers(int fd, int status, const char *reason,
+                         const char *type, uint64_t length,
+                         const char *extra) {
+    char head[512];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %d %s\r\n"
+                     "Content-Type: %s\r\n"
+                     "Content-Length: %llu\r\n"
+                     "Accept-Ranges: bytes\r\n"
+                     "%s"
+                     "Connection: close\r\n\r\n",
+                     status, reason, type, (unsigned long long)length, extra);
+    if (n > 0 && (size_t)n < sizeof(head))
+        (void)write_all(fd, head, (size_t)n);
+}
+
+static int send_error(int fd, int status, const char *reason, int head_only) {
+    char body[128];
+    int n = snprintf(body, sizeof(body), "%d %s\n", status, reason);
+    send_headers(fd, status, reason, "text/plain", (uint64_t)n, "");
+    if (!head_only)
+        (void)write_all(fd, body, (size_t)n);
+    return status;
+}
+
+static int serve_catalog(int fd, const char *tag, int head_only) {
+    serve_refresh_catalog(tag);
+
+    const struct IndexRelease *rel = tag ? index_find_release(tag)
+                                         : index_latest_release();
+    if (!rel)
+        return send_error(fd, 404, "Not Found", head_only);
+
+    json_t *obj = release_to_json(rel);
+    char *body = obj ? json_dumps(obj, JSON_COMPACT) : NULL;
+    json_decref(obj);
+    if (!body)
+        return send_error(fd, 500, "Internal Server Error", head_only);
+
+    size_t len = strlen(body); // flawfinder: ignore
+    send_headers(fd, 200, "OK", "application/json", len, "");
+    if (!head_only)
+        (void)write_all(fd, body, len);
+    free(body);
+    return 200;
+}
+
+// Fill a cache miss from upstream.  An fcntl() lock per archive makes
+// concurrent requests for the same file wait for a single download.
+static int serve_fill_cache(const char *tag, const char *name,
+                            const struct IndexAsset *asset, const char *path) {
+    char lock_path[MAX_PATH_LEN], part[MAX_PATH_LEN], dir[MAX_PATH_LEN];
+    struct stat st;
+
+    if (snprintf(lock_path, sizeof(lock_path), "%s.lock", path) >=
+            (int)sizeof(lock_path) ||
+        snprintf(part, sizeof(part), "%s.part", path) >= (int)sizeof(part))
+        return -1;
+
+    snprintf(dir, sizeof(dir), "%s", path);
+    *strrchr(dir, '/') = '\0';
+    if (create_directory_secure(dir) != 0)
+        return -1;
+
+    int lock_fd = open(lock_path, O_WRONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC,
+                       0600);
+    if (lock_fd == -1)
+        return -1;
+
+    struct flock fl = {0};
+    fl.l_type   = F_WRLCK;
+    fl.l_whence = SEEK_SET;
+    while (fcntl(lock_fd, F_SETLKW, &fl) == -1 && errno == EINTR)
+        ;
+
+    int rc = 0;
+    if (lstat(path, &st) != 0) { // still missing after waiting for the lock
+        const unsigned char *digest =
+            (asset->flags & ASSET_HAS_DIGEST) ? asset->sha256 : NULL;
+        rc = fetch_archive(tag, name, digest, asset->size, part) &&
+             rename(part, path) == 0 ? 0 : -1;
+        if (rc != 0)
+            secure_unlink(part);
+    }
+
+    close(lock_fd); // releases the lock
+    return rc;
+}
+
+// Find a "Range: bytes=..." header among the request headers and resolve
+// it against a file of size bytes.  Returns 0 when there is none, or it is
+// malformed or lists several ranges (all answered with the whole file), 1
+// with [*start, *end) set, or -1 when it cannot be satisfied.
+static int parse_range(const char *headers, uint64_t size, uint64_t *start,
+                       uint64_t *end) {
+    const char *line = headers;
+    while (line && *line && strncasecmp(line, "Range:", 6) != 0) {
+        line = strstr(line, "\r\n");
+        line = line ? line + 2 : NULL;
+    }
+    if (!line || !*line)
+        return 0;
+
+    const char *spec = line + 6;
+    while (*spec == ' ')
+        spec++;
+    size_t spec_len = strcspn(spec, "\r\n");
+    if (strncmp(spec, "bytes=", 6) != 0 || memchr(spec, ',', spec_len))
+        return 0;
+    spec += 6;
+
+    char *rest;
+    errno = 0;
+    if (*spec == '-') { // suffix: the last N bytes
+        unsigned long long n = strtoull(spec + 1, &rest, 10);
+        if (errno || rest == spec + 1)
+            return 0;
+        if (n == 0 || size == 0)
+            return -1;
+        *start = n < size ? size - n : 0;
+        *end   = size;
+        return 1;
+    }
+
+    unsigned long long first = strtoull(spec, &rest, 10), last;
+    if (errno || rest == spec || *rest != '-')
+        return 0;
+    if (first >= size)
+        return -1;
+    spec = rest + 1;
+    if (*spec == '\r' || *spec == '\n' || *spec == '\0') {
+        last = size - 1;
+    } else {
+        last = strtoull(spec, &rest, 10);
+        if (errno || rest == spec || last < first)
+            return 0;
+        if (last >= size)
+            last = size - 1;
+    }
+    *start = first;
+    *end   = last + 1;
+    return 1;
+}
+
+// Send a regular file, or the single byte range of it the client asked for.
+static int serve_file(int fd, const char *path, const char *type,
+                      const char *headers, int head_only) {
+    struct stat st;
+    int file = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (file == -1 || fstat(file, &st) != 0 || !S_ISREG(st.st_mode)) {
+        if (file != -1)
+            close(file);
+        return send_error(fd, 404, "Not Found", head_only);
+    }
+
+    uint64_t size = (uint64_t)st.st_size, start = 0, end = size;
+    char extra[128] = "";
+    int status = 200;
+    int range = parse_range(headers, size, &start, &end);
+    if (range < 0) {
+        close(file);
+        snprintf(extra, sizeof(extra), "Content-Range: bytes */%llu\r\n",
+                 (unsigned long long)size);
+        send_headers(fd, 416, "Range Not Satisfiable", "text/plain", 0, extra);
+        return 416;
+    }
+    if (range > 0) {
+        status = 206;
+        snprintf(extra, sizeof(extra), "Content-Range: bytes %llu-%llu/%llu\r\n",
+                 (unsigned long long)start, (unsigned long long)end - 1,
+                 (unsigned long long)size);
+    }
+
+    send_headers(fd, status, status == 206 ? "Partial Content" : "OK", type,
+                 end - start, extra);
+    if (!head_only && lseek(file, (off_t)start, SEEK_SET) == (off_t)start) {
+        unsigned char buf[65536];
+        uint64_t left = end - start;
+        while (left > 0) {
+            size_t want = left < sizeof(buf) ? (size_t)left : sizeof(buf);
+            ssize_t n = read(file, buf, want); // flawfinder: ignore
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0 || write_all(fd, buf, (size_t)n) != 0)
+                break;
+            left -= (uint64_t)n;
+        }
+    }
+    close(file);
+    return status;
+}
+
+// Make sure <tag>/<name>.zip is in the cache, filling it from upstream, and
+// return its path.  Returns 0, or the HTTP status to fail the request with.
+static int serve_ensure_archive(const char *tag, const char *name, char *path,
+                                size_t path_size) {
+    struct stat st;
+
+    serve_refresh_catalog(tag);
+
+    const struct IndexRelease *rel = index_find_release(tag);
+    const struct IndexAsset *asset = rel ? index_find_asset(rel, name) : NULL;
+    if (!asset || !archive_cache_path(tag, name, path, path_size))
+        return 404;
+
+    // Cached archives were verified when they were stored; clients verify
+    // again, so a cache hit is served without re-hashing.
+    if ((lstat(path, &st) != 0 || !S_ISREG(st.st_mode)) &&
+        serve_fill_cache(tag, name, asset, path) != 0)
+        return 502;
+    return 0;
+}
+
+static int serve_archive(int fd, const char *tag, const char *name,
+                         const char *headers, int head_only) {
+    char path[MAX_PATH_LEN];
+    int status = serve_ensure_archive(tag, name, path, sizeof(path));
+    if (status != 0)
+        return send_error(fd, status,
+                          status == 404 ? "Not Found" : "Bad Gateway",
+                          head_only);
+    return serve_file(fd, path, "application/zip", headers, head_only);
+}
+
+// Write the block index of archive to index_path, via a per-process temp
+// file so concurrent requests never see a partial index.
+static int write_block_index(const char *archive, const char *index_path) {
+    char part[MAX_PATH_LEN];
+    struct stat st;
+    if (snprintf(part, sizeof(part), "%s.%ld", index_path, (long)getpid()) >=
+        (int)sizeof(part))
+        return -1;
+
+    int in = open(archive, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (in == -1)
+        return -1;
+    if (fstat(in, &st) != 0 || st.st_size <= 0) {
+        close(in);
+        return -1;
+    }
+    size_t len = (size_t)st.st_size;
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, in, 0);
+    close(in);
+    if (map == MAP_FAILED)
+        return -1;
+
+    size_t index_len = delta_index_len(len, DELTA_BLOCK_SIZE);
+    unsigned char *index = index_len ? malloc(index_len) : NULL;
+    if (index)
+        delta_build_index(map, len, DELTA_BLOCK_SIZE, index);
+    munmap(map, len);
+    if (!index)
+        return -1;
+
+    int out = open(part, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+                   0644);
+    int rc = out != -1 && write_all(out, index, index_len) == 0 ? 0 : -1;
+    if (out != -1 && close(out) != 0)
+        rc = -1;
+    free(index);
+    if (rc == 0 && rename(part, index_path) != 0)
+        rc = -1;
+    if (rc != 0)
+        secure_unlink(part);
+    return rc;
+}
+
+// The block index delta clients match their old archive against,
+// generated next to the cached archive on first request.
+static int serve_block_index(int fd, const char *tag, const char *name,
+                             int head_only) {
+    char path[MAX_PATH_LEN], index_path[MAX_PATH_LEN];
+    struct stat archive_st, index_st;
+
+    int status = serve_ensure_archive(tag, name, path, sizeof(path));
+    if (status != 0)
+        return send_error(fd, status,
+                          status == 404 ? "Not Found" : "Bad Gateway",
+                          head_only);
+    if (snprintf(index_path, sizeof(index_path), "%s.blocks", path) >=
+        (int)sizeof(index_path) || stat(path, &archive_st) != 0)
+        return send_error(fd, 404, "Not Found", head_only);
+
+    if ((lstat(index_path, &index_st) != 0 ||
+         index_st.st_mtime < archive_st.st_mtime) &&
+        write_block_index(path, index_path) != 0)
+        return send_error(fd, 500, "Internal Server Error", head_only);
+    return serve_file(fd, index_path, "application/octet-stream", NULL,
+                      head_only);
+}
+
+// Read one request, route it and log the outcome.
+static void serve_client(int fd) {
+    char req[SERVE_MAX_REQUEST];
+    size_t used = 0;
+
+    while (used < sizeof(req) - 1) {
+        ssize_t n = read(fd, req + used, sizeof(req) - 1 - used); // flawfinder: ignore
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        used += (size_t)n;
+        req[used] = '\0';
+        if (strstr(req, "\r\n\r\n"))
+            break;
+    }
+    req[used] = '\0';
+
+    // Header lines follow the request line; routing only edits the latter.
+    const char *headers = strstr(req, "\r\n");
+    headers = headers ? headers + 2 : "";
+
+    // Request line: METHOD SP TARGET SP VERSION
+    char *target = strchr(req, ' ');
+    char *version = target ? strchr(target + 1, ' ') : NULL;
+    if (!target || !version) {
+        send_error(fd, 400, "Bad Request", 0);
+        return;
+    }
+    *target++ = '\0';
+    *version  = '\0';
+    target[strcspn(target, "?")] = '\0';
+
+    int head_only = strcmp(req, "HEAD") == 0;
+    int status;
+    char tag[MAX_TAG_LEN], name[MAX_FONT_NAME_LEN], part[MAX_PATH_LEN];
+
+    if (!head_only && strcmp(req, "GET") != 0) {
+        status = send_error(fd, 405, "Method Not Allowed", 0);
+    } else if (strcmp(target, "/releases/latest") == 0) {
+        status = serve_catalog(fd, NULL, head_only);
+    } else if (strncmp(target, "/releases/tags/", 15) == 0 &&
+               sanitize_font_name(target + 15, tag, sizeof(tag))) {
+        status = serve_catalog(fd, tag, head_only);
+    } else if (strncmp(target, "/download/", 10) == 0 &&
+               snprintf(part, sizeof(part), "%s", target + 10) <
+                   (int)sizeof(part) &&
+               strchr(part, '/') != NULL) {
+        char *file = strchr(part, '/');
+        *file++ = '\0';
+        size_t len = strlen(file); // flawfinder: ignore
+        int blocks = len > 11 && strcmp(file + len - 11, ".zip.blocks") == 0;
+        if (blocks)
+            file[len - 11] = '\0';
+        else if (len > 4 && strcmp(file + len - 4, ".zip") == 0)
+            file[len - 4] = '\0';
+        else
+            file[0] = '\0';
+
+        if (sanitize_font_name(part, tag, sizeof(tag)) &&
+            sanitize_font_name(file, name, sizeof(name)))
+            status = blocks
+                   ? serve_block_index(fd, tag, name, head_only)
+                   : serve_archive(fd, tag, name, headers, head_only);
+        else
+            status = send_error(fd, 404, "Not Found", head_only);
+    } else {
+        status = send_error(fd, 404, "Not Found", head_only);
+    }
+
+    printf("%s %s %d\n", req, target, status);
+}
+
+static void print_serve_usage(const char *prog) {
+    printf("Usage: %s serve [options]\n\n"
+           "Share this host's archive cache and release catalog over HTTP.\n"
+           "Clients use it with --mirror http://HOST:PORT.\n\n"
+           "Options:\n"
+           "  --bind ADDR       Address to listen on "
+           "(default: " SERVE_DEFAULT_BIND ")\n"
+           "  --port PORT       Port to listen on "
+           "(default: " SERVE_DEFAULT_PORT ")\n"
+           "  -h, --help        Show this help and exit\n", prog);
+}
+
+// `serve` subcommand (argv[1] == "serve").  One forked worker per
+// connection keeps a slow client from stalling the others.
+static int run_serve(int argc, char *argv[]) {
+    const char *bind_addr = SERVE_DEFAULT_BIND;
+    const char *port = SERVE_DEFAULT_PORT;
+
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_serve_usage(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) {
+            bind_addr = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = argv[++i];
+        } else {
+            fprintf(stderr, "Error: Unknown option: %s\n\n", argv[i]);
+            print_serve_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    resolve_user_paths();
+    (void)create_directory_secure(cache_path);
+
+    struct addrinfo hints = {0}, *res = NULL;
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = AI_PASSIVE;
+    int gai = getaddrinfo(bind_addr, port, &hints, &res);
+    if (gai != 0) {
+        printf("%sError: Cannot resolve %s:%s: %s\n%s",
+               COLOR_RED, bind_addr, port, gai_strerror(gai), COLOR_RESET);
+        return 1;
+    }
+
+    int listen_fd = socket(res->ai_family, res->ai_socktype | SOCK_CLOEXEC,
+                           res->ai_protocol);
+    int one = 1;
+    if (listen_fd == -1 ||
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one,
+                   sizeof(one)) != 0 ||
+        bind(listen_fd, res->ai_addr, res->ai_addrlen) != 0 ||
+        listen(listen_fd, 64) != 0) {
+        printf("%sError: Cannot listen on %s:%s: %s\n%s",
+               COLOR_RED, bind_addr, port, strerror(errno), COLOR_RESET);
+        if (listen_fd != -1)
+            close(listen_fd);
+        freeaddrinfo(res);
+        return 1;
+    }
+    freeaddrinfo(res);
+
+    // Workers are reaped automatically; a client hanging up mid-transfer
+    // must not kill its worker with SIGPIPE.
+    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+
+    open_release_index();
+    printf("%sServing %s on http://%s:%s\n%s",
+           COLOR_GREEN, cache_path, bind_addr, port, COLOR_RESET);
+    fflush(stdout);
+
+    while (1) {
+        int client = accept(listen_fd, NULL, NULL);
+        if (client == -1) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            printf("%sError: accept failed: %s\n%s",
+                   COLOR_RED, strerror(errno), COLOR_RESET);
+            break;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            struct timeval tv = { SERVE_IO_TIMEOUT, 0 };
+            close(listen_fd);
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+            serve_client(client);
+            close(client);
+            fflush(stdout);
+            _exit(0);
+        }
+        if (pid == -1)
+            send_error(client, 503, "Service Unavailable", 0);
+        close(client);
+    }
+
+    close(listen_fd);
+    close_release_index();
+    return 1;
+}
+
+// Parse an integer option value in [min, max].
+static int parse_long_arg(const char *arg, long min, long max, long *out) {
+    char *end;
+    errno = 0;
+    long value = strtol(arg, &end, 10);
+    if (errno != 0 || end == arg || *end != '\0' || value < min || value > max)
+        return 0;
+    *out = value;
+    return 1;
+}
+
+// Parse a --max-rate value: bytes per second, optionally with a K, M or G
+// suffix (powers of 1024, as curl's --limit-rate takes them).
+static int parse_rate_arg(const char *arg, uint64_t *out) {
+    char *end;
+    errno = 0;
+    unsigned long long value = strtoull(arg, &end, 10);
+    if (errno != 0 || end == arg || arg[0] == '-')
+        return 0;
+
+    int shift = 0;
+    switch (*end) {
+    case 'k': case 'K': shift = 10; end++; break;
+    case 'm': case 'M': shift = 20; end++; break;
+    case 'g': case 'G': shift = 30; end++; break;
+    default: break;
+    }
+    if (*end != '\0' || value > (UINT64_MAX >> shift) ||
+        (value << shift) < RATE_MIN)
+        return 0;
+    *out = (uint64_t)value << shift;
+    return 1;
+}
+
+// Validate and store the --mirror base URL (trailing slashes dropped).
+static int set_mirror_url(const char *url) {
+    size_t len = strlen(url); // flawfinder: ignore
+    if ((strncmp(url, "http://", 7) != 0 && strncmp(url, "https://", 8) != 0) ||
+        len >= sizeof(mirror_url) - 256)
+        return 0;
+    for (size_t i = 0; i < len; i++) {
+        if (isspace((unsigned char)url[i]) || iscntrl((unsigned char)url[i]))
+            return 0;
+    }
+
+    snprintf(mirror_url, sizeof(mirror_url), "%s", url);
+    while (len > 0 && mirror_url[len - 1] == '/')
+        mirror_url[--len] = '\0';
+    return 1;
+}
+
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options]\n"
+           "       %s prune [options] [FAMILY...]\n"
+           "       %s serve [options]\n\n"
+           "Options:\n"
+           "  --release TAG     Install from a specific Nerd Fonts release\n"
+           "                    (e.g. v3.4.0) instead of the latest one\n"
+           "  --list-releases   Refresh the local release index and list "
+           "known releases\n"
+           "  --mirror URL      Try a LAN mirror (`serve`) before GitHub\n"
+           "                    (default: $NERDFONTS_MIRROR)\n"
+           "  --keep-archives   Keep downloaded archives in the cache\n"
+           "  --delta           Fetch only the blocks that changed since the "
+           "cached\n"
+           "                    archive of an earlier release (needs a "
+           "mirror)\n"
+           "  --retries N       Retry failed transfers N times "
+           "(default: %d)\n"
+           "  --stall-timeout S Restart a transfer slower than 1 KiB/s for "
+           "S seconds\n"
+           "                    (default: %ld)\n"
+           "  --hedge-after S   Race a second connection when a download is "
+           "still\n"
+           "                    running after S seconds (default: off)\n"
+           "  --max-rate RATE   Limit all downloads together to RATE "
+           "bytes/s (K, M, G\n"
+           "                    suffixes; at least 16K); disables hedging\n"
+           "  --idle            Extract and rebuild the font cache at idle "
+           "I/O and\n"
+           "                    lowest CPU priority\n"
+           "  --prefetch LIST   Download these families (comma-separated, or "
+           "\"auto\"\n"
+           "                    for the most installed ones) while the "
+           "prompt is up\n"
+           "  --trace FILE      Write a Chrome trace-event timeline of the "
+           "run to FILE\n"
+           "  -h, --help        Show this help and exit\n\n"
+           "Commands:\n"
+           "  prune             Remove unwanted variants from installed "
+           "families\n"
+           "                    (see `%s prune --help`)\n"
+           "  serve             Share the archive cache with other hosts\n"
+           "                    (see `%s serve --help`)\n",
+           prog, prog, prog, DEFAULT_RETRIES, DEFAULT_STALL_TIMEOUT,
+           prog, prog);
+}
+
+int main(int argc, char *argv[]) {
+    int list_only = 0;
+    const char *trace_file = NULL;
+
+    if (argc > 1 && strcmp(argv[1], "prune") == 0) {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+        int rc = run_prune(argc, argv);
+        curl_global_cleanup();
+        return rc;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "serve") == 0) {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+        int rc = run_serve(argc, argv);
+        curl_global_cleanup();
+        return rc;
+    }
+
+    const char *mirror = getenv("NERDFONTS_MIRROR"); // flawfinder: ignore
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "--release") == 0 && i + 1 < argc) {
+            if (!sanitize_font_name(argv[++i], release_tag,
+                                    sizeof(release_tag))) {
+                fprintf(stderr, "Error: Invalid release tag\n");
+                return 1;
+            }
+            release_pinned = 1;
+        } else if (strcmp(argv[i], "--list-releases") == 0) {
+            list_only = 1;
+        } else if (strcmp(argv[i], "--mirror") == 0 && i + 1 < argc) {
+            mirror = argv[++i];
+        } else if (strcmp(argv[i], "--keep-archives") == 0) {
+            keep_archives = 1;
+        } else if (strcmp(argv[i], "--delta") == 0) {
+            delta_updates = 1;
+            keep_archives = 1; // the next release's delta base
+        } else if (strcmp(argv[i], "--retries") == 0 && i + 1 < argc) {
+            long value;
+            if (!parse_long_arg(argv[++i], 0, 20, &value)) {
+                fprintf(stderr, "Error: --retries expects 0-20\n");
+                return 1;
+            }
+            max_retries = (int)value;
+        } else if (strcmp(argv[i], "--stall-timeout") == 0 && i + 1 < argc) {
+            if (!parse_long_arg(argv[++i], 1, 3600, &stall_timeout)) {
+                fprintf(stderr, "Error: --stall-timeout expects 1-3600\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--hedge-after") == 0 && i + 1 < argc) {
+            if (!parse_long_arg(argv[++i], 0, 3600, &hedge_after)) {
+                fprintf(stderr, "Error: --hedge-after expects 0-3600\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--max-rate") == 0 && i + 1 < argc) {
+            if (!parse_rate_arg(argv[++i], &max_rate)) {
+                fprintf(stderr, "Error: --max-rate expects bytes/s of at "
+                        "least 16K (e.g. 500K, 2M)\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--idle") == 0) {
+            idle_priority = 1;
+        } else if (strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc) {
+            prefetch_list = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else {
+            fprintf(stderr, "Error: Unknown option: %s\n\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (mirror && mirror[0] != '\0' && !set_mirror_url(mirror)) {
+        fprintf(stderr, "Error: Mirror must be an http:// or https:// URL\n");
+        return 1;
+    }
+    // Under a rate limit a hedge only splits the same budget.
+    if (max_rate > 0 && hedge_after > 0) {
+        fprintf(stderr, "Error: --hedge-after cannot be combined with "
+                "--max-rate\n");
+        return 1;
+    }
+    if (delta_updates && mirror_url[0] == '\0') {
+        fprintf(stderr, "Error: --delta needs a mirror (--mirror or "
+                "$NERDFONTS_MIRROR)\n");
+        return 1;
+    }
+
+    if (trace_file && trace_open(trace_file) != 0) {
+        fprintf(stderr, "Error: Cannot write trace to %s: %s\n", trace_file,
+                strerror(errno));
+        return 1;
+    }
+
     signal(SIGINT,  signal_handler);
     signal(SIGTERM, signal_handler);
 
     curl_global_init(CURL_GLOBAL_DEFAULT);
+    curl_share = curl_share_init();
+    if (curl_share) {
+        curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+        curl_share_setopt(curl_share, CURLSHOPT_SHARE,
+                          CURL_LOCK_DATA_SSL_SESSION);
+    }
 
     printf("%s🚀 Nerd Fonts Installer\n%s", COLOR_GREEN, COLOR_RESET);
     print_separator();
     printf("\n");
 
+    if (list_only) {
+        create_directories();
+        open_release_index();
+        double started = monotonic_seconds();
+        list_releases();
+        trace_span("list releases", "phase", started, NULL);
+        close_release_index();
+        full_cleanup();
+        trace_close();
+        curl_share_cleanup(curl_share);
+        curl_global_cleanup();
+        return 0;
+    }
+
+    double started = monotonic_seconds();
     install_dependencies();
+    trace_span("dependencies", "phase", started, NULL);
+
+    started = monotonic_seconds();
     create_directories();
+    open_release_index();
+    trace_span("setup", "phase", started, NULL);
+
+    started = monotonic_seconds();
     fetch_available_fonts();
+    trace_span("catalog", "phase", started, NULL);
 
+    prefetch_start();
+
+    started = monotonic_seconds();
     printf("%s", COLOR_GREEN
            "Select fonts to install (space-separated numbers, or \"all\"):\n"
            COLOR_RESET);
     print_separator();
-    display_fonts_with_pager();
+    prefetch_wait_for_pager(display_fonts_with_pager());
     print_separator();
     printf("\n");
 
     int selected_indices[MAX_FONTS];
     int num_selected = 0;
     get_font_selection(selected_indices, &num_selected);
+    trace_span("selection", "phase", started, NULL);
+
+    started = monotonic_seconds();
+    prefetch_finish(selected_indices, num_selected);
+    trace_span("prefetch", "phase", started, NULL);
+
+    started = monotonic_seconds();
+    int fits = preflight_disk_space(selected_indices, num_selected);
+    trace_span("disk preflight", "phase", started, NULL);
+    if (!fits) {
+        prefetch_discard();
+        close_release_index();
+        full_cleanup();
+        trace_close();
+        curl_share_cleanup(curl_share);
+        curl_global_cleanup();
+        return 1;
+    }
 
+    started = monotonic_seconds();
     int installed_count = 0;
     for (int i = 0; i < num_selected; i++) {
-        if (download_and_install_font(fonts[selected_indices[i]]))
+        if (download_and_install_font(selected_indices[i]))
             installed_count++;
     }
+    trace_span("install", "phase", started, NULL);
+    prefetch_discard();
 
     if (installed_count > 0) {
-        update_font_cache();
+        update_font_cache(NULL, 0);
         printf("%s\n🎉 Successfully installed %d font%s!\n%s",
                COLOR_GREEN, installed_count,
                installed_count == 1 ? "" : "s",
@@ -900,7 +4897,10 @@ int main(void) {
         printf("%s", COLOR_RED "No fonts were installed.\n" COLOR_RESET);
     }
 
+    close_release_index();
     full_cleanup();
+    trace_close();
+    curl_share_cleanup(curl_share);
     curl_global_cleanup();
     return 0;
 }
@@ -0,0 +1,696 @@
+#define _POSIX_C_SOURCE 200809L
+#define ZLIB_CONST
+#include "nerdfonts_kernels.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#define ZIP_CHUNK 65536
+
+// ============================================================================
+// NAMES AND RESPONSES
+// ============================================================================
+
+// Whitelist-based font name sanitizer.
+// Copies only [a-zA-Z0-9._-] into output; rejects anything else.
+// Satisfies CodeQL taint tracking by producing a clean copy.
+int sanitize_font_name(const char *input, char *output, size_t max_len) {
+    if (!input || !output || max_len == 0)
+        return 0;
+
+    size_t in_len = strlen(input); // flawfinder: ignore
+    if (in_len == 0 || in_len >= max_len)
+        return 0;
+
+    // Reject leading dot or any path traversal
+    if (input[0] == '.' || strstr(input, "..") != NULL)
+        return 0;
+
+    size_t out_idx = 0;
+    for (size_t i = 0; input[i] != '\0'; i++) {
+        if (out_idx >= max_len - 1)
+            break;
+        char c = input[i];
+        if (isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.')
+            output[out_idx++] = c;
+        else
+            return 0; // strict rejection
+    }
+    output[out_idx] = '\0';
+    return 1;
+}
+
+// libcurl write callback.
+// Guards against integer overflow in size*nmemb and caps total response at
+// 100 MB to prevent memory exhaustion from a malicious/broken API response.
+size_t write_callback(const char *contents, size_t size, size_t nmemb,
+                      void *userp) {
+    struct HTTPResponse *response = (struct HTTPResponse *)userp;
+
+    // Overflow check before multiplication
+    if (nmemb > 0 && size > SIZE_MAX / nmemb)
+        return 0;
+
+    size_t realsize = size * nmemb;
+
+    // Response size cap — use subtraction to avoid overflow in the comparison
+    // itself: if realsize alone exceeds the limit, or adding it would exceed it.
+    if (realsize > 100UL * 1024UL * 1024UL ||
+        response->size > 100UL * 1024UL * 1024UL - realsize)
+        return 0;
+
+    char *ptr = realloc(response->memory, response->size + realsize + 1);
+    if (!ptr)
+        return 0;
+
+    response->memory = ptr;
+    memcpy(&(response->memory[response->size]), contents, realsize); // flawfinder: ignore
+    response->size += realsize;
+    response->memory[response->size] = '\0';
+
+    return realsize;
+}
+
+// ============================================================================
+// RELEASE ASSETS
+// ============================================================================
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Parse a GitHub asset digest ("sha256:<64 hex chars>") into raw bytes.
+int parse_sha256_digest(const char *digest, unsigned char *out) {
+    if (!digest || strncmp(digest, "sha256:", 7) != 0)
+        return 0;
+
+    const char *hex = digest + 7;
+    for (size_t i = 0; i < SHA256_LEN; i++) {
+        int hi = hex_value(hex[2 * i]);
+        if (hi < 0)
+            return 0;
+        int lo = hex_value(hex[2 * i + 1]);
+        if (lo < 0)
+            return 0;
+        out[i] = (unsigned char)((hi << 4) | lo);
+    }
+    return hex[2 * SHA256_LEN] == '\0';
+}
+
+// Decide whether a release asset is an installable font archive and, if so,
+// copy its name without the .zip suffix into bare.
+int asset_font_name(const json_t *asset, char *bare, size_t bare_size) {
+    json_t *name_obj = json_object_get(asset, "name");
+    if (!json_is_string(name_obj))
+        return 0;
+
+    const char *name = json_string_value(name_obj);
+    size_t len = strlen(name); // flawfinder: ignore
+
+    // Must end in ".zip"
+    if (len <= 4 || strcmp(name + len - 4, ".zip") != 0)
+        return 0;
+
+    // Exclude the font patcher archive — it is not a font.
+    if (strcmp(name, "FontPatcher.zip") == 0)
+        return 0;
+
+    // Strip .zip suffix; download_and_install_font() re-appends it.
+    size_t bare_len = len - 4;
+    if (bare_len >= bare_size)
+        return 0;
+
+    for (size_t i = 0; i < bare_len; i++)
+        bare[i] = name[i];
+    bare[bare_len] = '\0';
+    return 1;
+}
+
+// Copy every installable font asset (name, size, digest) into list.
+// Returns how many font assets did not fit.
+int filter_font_assets(const json_t *assets, struct FontList *list) {
+    size_t index;
+    json_t *value;
+    int omitted = 0;
+    list->count = 0;
+
+    json_array_foreach(assets, index, value) {
+        char name[MAX_FONT_NAME_LEN];
+        if (!asset_font_name(value, name, sizeof(name)))
+            continue;
+        if (list->count >= MAX_FONTS) {
+            omitted++;
+            continue;
+        }
+
+        int n = list->count;
+        memcpy(list->names[n], name, sizeof(name)); // flawfinder: ignore
+
+        json_t *size_obj = json_object_get(value, "size");
+        list->sizes[n] =
+            (json_is_integer(size_obj) && json_integer_value(size_obj) > 0)
+                ? (uint64_t)json_integer_value(size_obj) : 0;
+
+        json_t *digest_obj = json_object_get(value, "digest");
+        list->has_digest[n] = json_is_string(digest_obj) &&
+            parse_sha256_digest(json_string_value(digest_obj),
+                                list->digests[n]);
+        list->count++;
+    }
+    return omitted;
+}
+
+// Print the font list in columns that fit term_width.
+void print_fonts_in_columns(FILE *out, const struct FontList *list,
+                            int term_width) {
+    int max_len = 0;
+
+    for (int i = 0; i < list->count; i++) {
+        int len = (int)strnlen(list->names[i], MAX_FONT_NAME_LEN);
+        if (len > max_len)
+            max_len = len;
+    }
+
+    int col_width = max_len + 8; // "NNN. " prefix + padding
+    int columns   = term_width / col_width;
+    if (columns == 0)
+        columns = 1;
+
+    int rows = (list->count + columns - 1) / columns;
+
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < columns; j++) {
+            int idx = i + j * rows;
+            if (idx < list->count) {
+                char item[MAX_FONT_NAME_LEN + 20];
+                snprintf(item, sizeof(item), "%d. %.*s",
+                         idx + 1, MAX_FONT_NAME_LEN, list->names[idx]);
+                fprintf(out, "%-*s", col_width, item);
+            }
+        }
+        fputc('\n', out);
+    }
+}
+
+// ============================================================================
+// SHA-256 (FIPS 180-4), used to verify downloaded archives
+// ============================================================================
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_compress(uint32_t state[8], const unsigned char *block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = ((uint32_t)block[4 * i] << 24) |
+               ((uint32_t)block[4 * i + 1] << 16) |
+               ((uint32_t)block[4 * i + 2] << 8) |
+               (uint32_t)block[4 * i + 3];
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^
+                      (w[i - 15] >> 3);
+        uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^
+                      (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25)) +
+                      ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22)) +
+                      ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void sha256_init(struct Sha256 *ctx) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->state, iv, sizeof(iv)); // flawfinder: ignore
+    ctx->length = 0;
+    ctx->used   = 0;
+}
+
+void sha256_update(struct Sha256 *ctx, const void *data, size_t len) {
+    const unsigned char *p = data;
+    ctx->length += len;
+
+    if (ctx->used > 0) {
+        size_t take = 64 - ctx->used < len ? 64 - ctx->used : len;
+        memcpy(ctx->block + ctx->used, p, take); // flawfinder: ignore
+        ctx->used += take;
+        p   += take;
+        len -= take;
+        if (ctx->used < 64)
+            return;
+        sha256_compress(ctx->state, ctx->block);
+        ctx->used = 0;
+    }
+    for (; len >= 64; p += 64, len -= 64)
+        sha256_compress(ctx->state, p);
+    if (len > 0) {
+        memcpy(ctx->block, p, len); // flawfinder: ignore
+        ctx->used = len;
+    }
+}
+
+void sha256_final(struct Sha256 *ctx, unsigned char out[SHA256_LEN]) {
+    uint64_t bits = ctx->length * 8;
+    static const unsigned char pad[64] = {0x80};
+    unsigned char len_be[8];
+
+    for (int i = 0; i < 8; i++)
+        len_be[i] = (unsigned char)(bits >> (56 - 8 * i));
+
+    sha256_update(ctx, pad, ctx->used < 56 ? 56 - ctx->used
+                                           : 120 - ctx->used);
+    sha256_update(ctx, len_be, sizeof(len_be));
+
+    for (int i = 0; i < 8; i++) {
+        out[4 * i]     = (unsigned char)(ctx->state[i] >> 24);
+        out[4 * i + 1] = (unsigned char)(ctx->state[i] >> 16);
+        out[4 * i + 2] = (unsigned char)(ctx->state[i] >> 8);
+        out[4 * i + 3] = (unsigned char)ctx->state[i];
+    }
+}
+
+// ============================================================================
+// ZIP ARCHIVES
+// ============================================================================
+
+static uint16_t read_le16(const unsigned char *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Find the end-of-central-directory record in the last bytes of a zip;
+// data may be the whole archive or only its tail.  Stores the directory's
+// offset and size as the record gives them, relative to the start of the
+// archive.  ZIP64 archives are rejected since no font archive comes near
+// 4 GiB.  Returns the record's offset in data, or -1.
+long zip_find_end(const unsigned char *data, size_t len, uint32_t *cd_off,
+                  uint32_t *cd_size) {
+    if (!data || len < ZIP_EOCD_LEN)
+        return -1;
+
+    // The end-of-central-directory record is last, possibly followed by a
+    // comment of up to 64 KiB; scan backwards for its signature.
+    size_t lowest = len > ZIP_EOCD_LEN + ZIP_MAX_COMMENT
+                  ? len - ZIP_EOCD_LEN - ZIP_MAX_COMMENT : 0;
+    size_t eocd = SIZE_MAX;
+    for (size_t pos = len - ZIP_EOCD_LEN + 1; pos-- > lowest;) {
+        if (read_le32(data + pos) == ZIP_EOCD_SIG) {
+            eocd = pos;
+            break;
+        }
+    }
+    if (eocd == SIZE_MAX)
+        return -1;
+
+    const unsigned char *e = data + eocd;
+    *cd_size = read_le32(e + 12);
+    *cd_off  = read_le32(e + 16);
+    if (read_le16(e + 10) == 0xffffU || *cd_off == 0xffffffffU)
+        return -1;
+    return (long)eocd;
+}
+
+// Walk a zip's central directory without decompressing anything.
+// Every record is bounds-checked against len.  Returns the number of
+// entries visited, or -1 if the archive is malformed or fn returns
+// non-zero.
+long zip_for_each_entry(const unsigned char *data, size_t len,
+                        zip_entry_fn fn, void *ctx) {
+    uint32_t cd_off, cd_size;
+    long     eocd = zip_find_end(data, len, &cd_off, &cd_size);
+    if (eocd < 0 || (uint64_t)cd_off + cd_size > (uint64_t)eocd)
+        return -1;
+
+    uint16_t entries = read_le16(data + eocd + 10);
+
+    size_t pos = cd_off;
+    size_t end = (size_t)cd_off + cd_size;
+    long   count = 0;
+
+    for (uint32_t i = 0; i < entries; i++) {
+        if (end - pos < ZIP_CDIR_LEN)
+            return -1;
+
+        const unsigned char *c = data + pos;
+        if (read_le32(c) != ZIP_CDIR_SIG)
+            return -1;
+
+        size_t name_len = read_le16(c + 28);
+        size_t record   = ZIP_CDIR_LEN + name_len + read_le16(c + 30) +
+                          read_le16(c + 32);
+        if (end - pos < record)
+            return -1;
+
+        struct ZipEntry entry = {
+            .name         = (const char *)c + ZIP_CDIR_LEN,
+            .name_len     = name_len,
+            .method       = read_le16(c + 10),
+            .crc32        = read_le32(c + 16),
+            .comp_size    = read_le32(c + 20),
+            .size         = read_le32(c + 24),
+            .local_offset = read_le32(c + 42),
+            .archive      = data,
+            .archive_len  = len,
+        };
+        if (fn && fn(&entry, ctx) != 0)
+            return -1;
+
+        pos += record;
+        count++;
+    }
+    return count;
+}
+
+// Copy an entry name into out if it is a safe relative file path: not
+// absolute, no "..", no backslashes or control characters, not a directory.
+int zip_entry_safe_name(const struct ZipEntry *entry, char *out,
+                        size_t out_size) {
+    if (entry->name_len == 0 || entry->name_len >= out_size ||
+        entry->name[0] == '/' || entry->name[entry->name_len - 1] == '/')
+        return 0;
+
+    for (size_t i = 0; i < entry->name_len; i++) {
+        unsigned char c = (unsigned char)entry->name[i];
+        if (c < 0x20 || c == 0x7f || c == '\\')
+            return 0;
+        out[i] = (char)c;
+    }
+    out[entry->name_len] = '\0';
+    return strstr(out, "..") == NULL;
+}
+
+// Decompress one stored or deflated entry into sink, in chunks of at most
+// ZIP_CHUNK bytes.  The local header and compressed data are bounds-checked
+// against the archive, and the output must match the central directory's
+// size and CRC-32.  Returns 0, or -1 if the entry is corrupt, encrypted or
+// uses another method, or if sink fails.
+int zip_extract_entry(const struct ZipEntry *entry, zip_sink_fn sink,
+                      void *ctx) {
+    const unsigned char *data = entry->archive;
+    size_t len = entry->archive_len;
+    if (entry->local_offset > len ||
+        len - entry->local_offset < ZIP_LOCAL_LEN)
+        return -1;
+
+    const unsigned char *l = data + entry->local_offset;
+    if (read_le32(l) != ZIP_LOCAL_SIG || (read_le16(l + 6) & 0x1U) != 0)
+        return -1;
+
+    // The local header repeats name and extra field with its own lengths.
+    uint64_t start = entry->local_offset + ZIP_LOCAL_LEN +
+                     read_le16(l + 26) + read_le16(l + 28);
+    if (start > len || len - start < entry->comp_size)
+        return -1;
+
+    const unsigned char *in = data + start;
+    uLong crc = crc32(0L, Z_NULL, 0);
+    uint64_t produced = 0;
+
+    if (entry->method == ZIP_STORED) {
+        if (entry->comp_size != entry->size)
+            return -1;
+        while (produced < entry->size) {
+            uint64_t left = entry->size - produced;
+            size_t n = left < ZIP_CHUNK ? (size_t)left : ZIP_CHUNK;
+            crc = crc32(crc, in + produced, (uInt)n);
+            if (sink(in + produced, n, ctx) != 0)
+                return -1;
+            produced += n;
+        }
+    } else if (entry->method == ZIP_DEFLATED) {
+        unsigned char out[ZIP_CHUNK];
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+            return -1;
+        zs.next_in  = in;
+        zs.avail_in = (uInt)entry->comp_size;
+
+        int zrc;
+        do {
+            zs.next_out  = out;
+            zs.avail_out = sizeof(out);
+            zrc = inflate(&zs, Z_NO_FLUSH);
+            if (zrc != Z_OK && zrc != Z_STREAM_END)
+                break;
+
+            size_t n = sizeof(out) - zs.avail_out;
+            produced += n;
+            // Never inflate past the declared size (zip bombs).
+            if (produced > entry->size) {
+                zrc = Z_DATA_ERROR;
+                break;
+            }
+            crc = crc32(crc, out, (uInt)n);
+            if (n > 0 && sink(out, n, ctx) != 0) {
+                zrc = Z_ERRNO;
+                break;
+            }
+        } while (zrc != Z_STREAM_END);
+        inflateEnd(&zs);
+        if (zrc != Z_STREAM_END)
+            return -1;
+    } else {
+        return -1;
+    }
+
+    return produced == entry->size && crc == entry->crc32 ? 0 : -1;
+}
+
+// ============================================================================
+// DELTA UPDATES
+// ============================================================================
+
+static void write_le32(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static uint64_t read_le64(const unsigned char *p) {
+    return (uint64_t)read_le32(p) | ((uint64_t)read_le32(p + 4) << 32);
+}
+
+// rsync's rolling checksum: a is the byte sum, b the position-weighted sum,
+// both mod 2^16, so sliding the window one byte is O(1).
+static uint32_t weak_sum(const unsigned char *p, size_t n, uint32_t *a_out,
+                         uint32_t *b_out) {
+    uint32_t a = 0, b = 0;
+    for (size_t i = 0; i < n; i++) {
+        a += p[i];
+        b += (uint32_t)(n - i) * p[i];
+    }
+    *a_out = a & 0xffffU;
+    *b_out = b & 0xffffU;
+    return *a_out | (*b_out << 16);
+}
+
+static void strong_sum(const unsigned char *p, size_t n,
+                       unsigned char out[DELTA_STRONG_LEN]) {
+    struct Sha256 ctx;
+    unsigned char digest[SHA256_LEN];
+    sha256_init(&ctx);
+    sha256_update(&ctx, p, n);
+    sha256_final(&ctx, digest);
+    memcpy(out, digest, DELTA_STRONG_LEN); // flawfinder: ignore
+}
+
+// Bytes delta_build_index writes for a file of file_size, or 0 if the
+// block size is out of range.
+size_t delta_index_len(uint64_t file_size, uint32_t block_size) {
+    if (block_size < DELTA_MIN_BLOCK || block_size > DELTA_MAX_BLOCK)
+        return 0;
+    uint64_t count = (file_size + block_size - 1) / block_size;
+    if (count > (SIZE_MAX - DELTA_HEADER_LEN) / DELTA_RECORD_LEN)
+        return 0;
+    return DELTA_HEADER_LEN + (size_t)count * DELTA_RECORD_LEN;
+}
+
+// Write the block index of data into out, which must hold
+// delta_index_len(len, block_size) bytes.
+void delta_build_index(const unsigned char *data, size_t len,
+                       uint32_t block_size, unsigned char *out) {
+    struct Sha256 ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, len);
+
+    write_le32(out, DELTA_MAGIC);
+    write_le32(out + 4, DELTA_VERSION);
+    write_le32(out + 8, block_size);
+    write_le32(out + 12, (uint32_t)len);
+    write_le32(out + 16, (uint32_t)((uint64_t)len >> 32));
+    sha256_final(&ctx, out + 20);
+
+    unsigned char *rec = out + DELTA_HEADER_LEN;
+    for (size_t off = 0; off < len; off += block_size) {
+        size_t n = len - off < block_size ? len - off : block_size;
+        uint32_t a, b;
+        write_le32(rec, weak_sum(data + off, n, &a, &b));
+        strong_sum(data + off, n, rec + 4);
+        rec += DELTA_RECORD_LEN;
+    }
+}
+
+// Validate a block index received from a mirror.  Returns 1 on success.
+int delta_parse_index(const unsigned char *data, size_t len,
+                      struct BlockIndex *index) {
+    if (!data || len < DELTA_HEADER_LEN ||
+        read_le32(data) != DELTA_MAGIC ||
+        read_le32(data + 4) != DELTA_VERSION)
+        return 0;
+
+    index->block_size = read_le32(data + 8);
+    index->file_size  = read_le64(data + 12);
+    size_t expected = delta_index_len(index->file_size, index->block_size);
+    if (expected == 0 || expected != len)
+        return 0;
+
+    memcpy(index->sha256, data + 20, SHA256_LEN); // flawfinder: ignore
+    index->count   = (len - DELTA_HEADER_LEN) / DELTA_RECORD_LEN;
+    index->records = data + DELTA_HEADER_LEN;
+    return 1;
+}
+
+// Does old[pos, pos + n) have block blk's strong checksum?  strong caches
+// the window's checksum across the candidates of one position.
+static int strong_matches(const struct BlockIndex *index, size_t blk,
+                          const unsigned char *window, size_t n,
+                          unsigned char strong[DELTA_STRONG_LEN],
+                          int *have_strong) {
+    if (!*have_strong) {
+        strong_sum(window, n, strong);
+        *have_strong = 1;
+    }
+    return memcmp(strong, index->records + blk * DELTA_RECORD_LEN + 4,
+                  DELTA_STRONG_LEN) == 0;
+}
+
+// Find where each block of the new file already appears in old, sliding a
+// rolling checksum over old one byte at a time the way zsync does.
+// matches[i] receives an offset into old, or DELTA_NO_MATCH.  Returns the
+// number of blocks matched, or -1 on allocation failure.
+long delta_match_blocks(const struct BlockIndex *index,
+                        const unsigned char *old, size_t old_len,
+                        uint64_t *matches) {
+    size_t bs   = index->block_size;
+    size_t full = (size_t)(index->file_size / bs);
+    long matched = 0;
+
+    for (size_t i = 0; i < index->count; i++)
+        matches[i] = DELTA_NO_MATCH;
+
+    // Full blocks, chained by a hash of their rolling checksum.
+    if (full >= UINT32_MAX)
+        return -1;
+    size_t nbuckets = 1;
+    while (nbuckets < 2 * full)
+        nbuckets <<= 1;
+    uint32_t *heads = calloc(nbuckets, sizeof(*heads));
+    uint32_t *next  = calloc(full ? full : 1, sizeof(*next));
+    if (!heads || !next) {
+        free(heads);
+        free(next);
+        return -1;
+    }
+    for (size_t i = full; i-- > 0;) {
+        uint32_t weak = read_le32(index->records + i * DELTA_RECORD_LEN);
+        size_t h = (weak * 2654435761U) & (nbuckets - 1);
+        next[i]  = heads[h];
+        heads[h] = (uint32_t)i + 1;
+    }
+
+    size_t pos = 0;
+    uint32_t a = 0, b = 0;
+    if (full > 0 && old_len >= bs)
+        weak_sum(old, bs, &a, &b);
+    while (full > 0 && pos + bs <= old_len) {
+        uint32_t weak = a | (b << 16);
+        unsigned char strong[DELTA_STRONG_LEN];
+        int have_strong = 0, hit = 0;
+
+        for (uint32_t j = heads[(weak * 2654435761U) & (nbuckets - 1)]; j;
+             j = next[j - 1]) {
+            size_t blk = j - 1;
+            if (matches[blk] != DELTA_NO_MATCH ||
+                read_le32(index->records + blk * DELTA_RECORD_LEN) != weak ||
+                !strong_matches(index, blk, old + pos, bs, strong,
+                                &have_strong))
+                continue;
+            matches[blk] = pos;
+            matched++;
+            hit = 1;
+        }
+
+        if (hit) {
+            pos += bs;
+            if (pos + bs <= old_len)
+                weak_sum(old + pos, bs, &a, &b);
+        } else {
+            if (pos + bs >= old_len)
+                break;
+            uint32_t out = old[pos], in = old[pos + bs];
+            a = (a - out + in) & 0xffffU;
+            b = (b - (uint32_t)(bs * out) + a) & 0xffffU;
+            pos++;
+        }
+    }
+    free(heads);
+    free(next);
+
+    // A short last block (usually the central directory) is only looked
+    // for at the end of old.
+    size_t tail = (size_t)(index->file_size % bs);
+    if (tail > 0 && old_len >= tail) {
+        const unsigned char *rec = index->records + full * DELTA_RECORD_LEN;
+        unsigned char strong[DELTA_STRONG_LEN];
+        int have_strong = 0;
+        uint32_t ta, tb;
+        if (weak_sum(old + old_len - tail, tail, &ta, &tb) == read_le32(rec) &&
+            strong_matches(index, full, old + old_len - tail, tail, strong,
+                           &have_strong)) {
+            matches[full] = old_len - tail;
+            matched++;
+        }
+    }
+    return matched;
+}
@@ -0,0 +1,125 @@
+// Catalog and archive kernels shared by the installer, the microbenchmarks
+// in bench/ and the fuzz harnesses in fuzz/.  Everything here is pure: no
+// globals, no network, no filesystem.
+#ifndef NERDFONTS_KERNELS_H
+#define NERDFONTS_KERNELS_H
+
+#include <jansson.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define MAX_FONTS         100
+#define MAX_FONT_NAME_LEN 50
+#define SHA256_LEN        32
+
+// Zip records (PKWARE APPNOTE 4.3.7 / 4.3.12 / 4.3.16).
+#define ZIP_LOCAL_SIG    0x04034b50U
+#define ZIP_EOCD_SIG     0x06054b50U
+#define ZIP_CDIR_SIG     0x02014b50U
+#define ZIP_LOCAL_LEN    30U
+#define ZIP_EOCD_LEN     22U
+#define ZIP_CDIR_LEN     46U
+#define ZIP_MAX_COMMENT  0xffffU
+#define ZIP_STORED       0
+#define ZIP_DEFLATED     8
+
+// Block index for delta updates: a header (magic, version, block size,
+// file size, SHA-256 of the file), then one record per block of the file
+// (rolling checksum, truncated SHA-256).  The last block may be short.
+// All fields little-endian.
+#define DELTA_MAGIC      0x4c42464eU   // "NFBL"
+#define DELTA_VERSION    1U
+#define DELTA_HEADER_LEN 52U
+#define DELTA_STRONG_LEN 16U
+#define DELTA_RECORD_LEN (4U + DELTA_STRONG_LEN)
+#define DELTA_BLOCK_SIZE 4096U
+#define DELTA_MIN_BLOCK  512U
+#define DELTA_MAX_BLOCK  (1U << 20)
+#define DELTA_NO_MATCH   UINT64_MAX
+
+// HTTP response buffer
+struct HTTPResponse {
+    char  *memory;
+    size_t size;
+};
+
+// Installable fonts of one release, in asset order.
+struct FontList {
+    char          names[MAX_FONTS][MAX_FONT_NAME_LEN];
+    uint64_t      sizes[MAX_FONTS];
+    unsigned char digests[MAX_FONTS][SHA256_LEN];
+    int           has_digest[MAX_FONTS];
+    int           count;
+};
+
+// One central directory record.  name points into the archive and is not
+// NUL-terminated.
+struct ZipEntry {
+    const char          *name;
+    size_t               name_len;
+    uint16_t             method;
+    uint32_t             crc32;
+    uint64_t             comp_size;
+    uint64_t             size;
+    uint64_t             local_offset;
+    const unsigned char *archive;      // the whole archive being walked
+    size_t               archive_len;
+};
+
+struct Sha256 {
+    uint32_t      state[8];
+    uint64_t      length;
+    unsigned char block[64];
+    size_t        used;
+};
+
+// A parsed block index.  records points into the parsed buffer.
+struct BlockIndex {
+    uint32_t             block_size;
+    uint64_t             file_size;
+    unsigned char        sha256[SHA256_LEN];
+    size_t               count;
+    const unsigned char *records;
+};
+
+typedef int (*zip_entry_fn)(const struct ZipEntry *entry, void *ctx);
+
+// Receives decompressed entry data; non-zero aborts the extraction.
+typedef int (*zip_sink_fn)(const unsigned char *buf, size_t len, void *ctx);
+
+int sanitize_font_name(const char *input, char *output, size_t max_len);
+
+size_t write_callback(const char *contents, size_t size, size_t nmemb,
+                      void *userp);
+
+int parse_sha256_digest(const char *digest, unsigned char *out);
+int asset_font_name(const json_t *asset, char *bare, size_t bare_size);
+int filter_font_assets(const json_t *assets, struct FontList *list);
+
+void print_fonts_in_columns(FILE *out, const struct FontList *list,
+                            int term_width);
+
+void sha256_init(struct Sha256 *ctx);
+void sha256_update(struct Sha256 *ctx, const void *data, size_t len);
+void sha256_final(struct Sha256 *ctx, unsigned char out[SHA256_LEN]);
+
+long zip_find_end(const unsigned char *data, size_t len, uint32_t *cd_off,
+                  uint32_t *cd_size);
+long zip_for_each_entry(const unsigned char *data, size_t len,
+                        zip_entry_fn fn, void *ctx);
+int  zip_entry_safe_name(const struct ZipEntry *entry, char *out,
+                         size_t out_size);
+int  zip_extract_entry(const struct ZipEntry *entry, zip_sink_fn sink,
+                       void *ctx);
+
+size_t delta_index_len(uint64_t file_size, uint32_t block_size);
+void   delta_build_index(const unsigned char *data, size_t len,
+                         uint32_t block_size, unsigned char *out);
+int    delta_parse_index(const unsigned char *data, size_t len,
+                         struct BlockIndex *index);
+long   delta_match_blocks(const struct BlockIndex *index,
+                          const unsigned char *old, size_t old_len,
+                          uint64_t *matches);
+
+#endif